@@ -0,0 +1,48 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <AllocationCounter.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::size_t> AllocationCount{0};
+
+}  // namespace
+
+std::size_t GetAllocationCount() {
+    return AllocationCount.load();
+}
+
+void* operator new(std::size_t size) {
+    AllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (auto pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
@@ -0,0 +1,15 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_ALLOCATIONCOUNTER_HPP_
+#define CG_LAB_ALLOCATIONCOUNTER_HPP_
+
+#include <cstdint>
+
+// Number of global operator new calls made by the benchmark process
+// from any thread
+std::size_t GetAllocationCount();
+
+#endif  // CG_LAB_ALLOCATIONCOUNTER_HPP_
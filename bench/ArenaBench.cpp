@@ -0,0 +1,88 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <AllocationCounter.hpp>
+#include <BenchFixture.hpp>
+#include <Benchmark.hpp>
+#include <Ellipsoid.hpp>
+
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace {
+
+using namespace BenchFixture;
+
+const auto VIEW_COUNT = 16;
+
+// Mean heap allocations per call over a full turn of views
+template <typename Func>
+double CountAllocations(Func&& func) {
+    const auto PI = 4 * std::atan(1.0f);
+
+    // The first turn grows the storage and the per thread scratch
+    for (auto i = 0; i < VIEW_COUNT; i++) {
+        func(GenerateRotateMatrix(2 * PI * i / VIEW_COUNT));
+    }
+
+    const auto start = GetAllocationCount();
+    for (auto i = 0; i < VIEW_COUNT; i++) {
+        func(GenerateRotateMatrix(2 * PI * i / VIEW_COUNT));
+    }
+    return 1.0 * (GetAllocationCount() - start) / VIEW_COUNT;
+}
+
+}  // namespace
+
+// Returns false when the arena path allocates in the steady state
+bool RunArenaBenchmarks(Benchmark::SizeType iterations) {
+    const auto PI = 4 * std::atan(1.0f);
+    auto allocationFree = true;
+
+    for (auto [vertexCount, surfaceCount] :
+         {std::pair{20UL, 60UL}, {100UL, 100UL}}) {
+        const auto suffix = "(vertex=" + std::to_string(vertexCount) +
+                            ", surface=" + std::to_string(surfaceCount) + ")";
+        auto ellipsoid =
+            Ellipsoid(A, B, C, vertexCount, surfaceCount, VIEW_POINT);
+
+        // Two arenas are swapped on every view change like the renderer does
+        std::array<VertexArena, 2> arenas;
+        auto current = 0UL;
+        auto generateToArena = [&](const Mat4x4& matrix) {
+            current = 1 - current;
+            ellipsoid.GenerateVertices(matrix, arenas[current]);
+        };
+        auto generateLayers = [&](const Mat4x4& matrix) {
+            ellipsoid.GenerateVertices(matrix);
+        };
+
+        Benchmark::Report("layer vector allocations " + suffix,
+                          CountAllocations(generateLayers), "per call");
+        const auto arenaAllocations = CountAllocations(generateToArena);
+        Benchmark::Report("arena allocations " + suffix, arenaAllocations,
+                          "per call");
+        if (arenaAllocations > 0) {
+            std::cerr << "Arena path allocates " << arenaAllocations
+                      << " times per call " << suffix << std::endl;
+            allocationFree = false;
+        }
+
+        auto view = 0;
+        Benchmark::Run("layer vector, view change " + suffix, iterations,
+                       [&]() {
+                           const auto angle = 2 * PI * view++ / VIEW_COUNT;
+                           generateLayers(GenerateRotateMatrix(angle));
+                       });
+        Benchmark::Run("arena, view change " + suffix, iterations, [&]() {
+            const auto angle = 2 * PI * view++ / VIEW_COUNT;
+            generateToArena(GenerateRotateMatrix(angle));
+        });
+    }
+
+    return allocationFree;
+}
@@ -0,0 +1,43 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <AsyncMeshBuilder.hpp>
+#include <BenchFixture.hpp>
+#include <Benchmark.hpp>
+
+#include <string>
+
+using namespace BenchFixture;
+
+// Time the GUI thread spends per slider change: a synchronous rebuild
+// against a request to the background builder, and the time until the
+// requested mesh is published, which may include finishing a build that
+// was already running
+void RunAsyncBenchmarks(Benchmark::SizeType iterations) {
+    const auto ellipsoid = Ellipsoid(A, B, C, 100, 100, VIEW_POINT);
+    const Mat4x4 rotateMatrix = Mat4x4::Identity();
+
+    VertexArena arena;
+    Benchmark::Run("sync rebuild (vertex=100, surface=100)", iterations,
+                   [&]() { ellipsoid.GenerateVertices(rotateMatrix, arena); });
+
+    AsyncMeshBuilder builder(ellipsoid, nullptr);
+    AsyncMeshBuilder::MeshRequest request;
+    request.VertexCount = 100;
+    request.SurfaceCount = 100;
+    request.RotateMatrix = rotateMatrix;
+
+    Benchmark::Run("async request (vertex=100, surface=100)", iterations,
+                   [&]() { builder.Request(request); });
+
+    Benchmark::Run("async request to publish (vertex=100, surface=100)",
+                   iterations, [&]() {
+                       while (builder.Take() != nullptr) {
+                       }
+                       builder.Request(request);
+                       while (builder.Take() == nullptr) {
+                       }
+                   });
+}
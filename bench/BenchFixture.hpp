@@ -0,0 +1,33 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_BENCHFIXTURE_HPP_
+#define CG_LAB_BENCHFIXTURE_HPP_
+
+#include <GeometryTypes.hpp>
+
+#include <cmath>
+
+// Ellipsoid of the application window, measured by every benchmark
+namespace BenchFixture {
+
+inline const Vec3 VIEW_POINT = Vec3(0, 0, 1);
+constexpr LenghtType A = 1.1f;
+constexpr LenghtType B = 1.5f;
+constexpr LenghtType C = 0.2f;
+
+// Rotation around OX, tilted views cull a part of every layer
+inline Mat4x4 GenerateRotateMatrix(float angle) {
+    Mat4x4 matrix = Mat4x4::Identity();
+    matrix(1, 1) = std::cos(angle);
+    matrix(1, 2) = std::sin(angle);
+    matrix(2, 1) = -std::sin(angle);
+    matrix(2, 2) = std::cos(angle);
+    return matrix;
+}
+
+}  // namespace BenchFixture
+
+#endif  // CG_LAB_BENCHFIXTURE_HPP_
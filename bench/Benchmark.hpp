@@ -0,0 +1,106 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_BENCHMARK_HPP_
+#define CG_LAB_BENCHMARK_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Minimal timing helper shared by the benchmark executable. Every
+// reported value is kept, so a run can be saved and compared with runs
+// of other commits.
+class Benchmark {
+public:
+    using SizeType = std::size_t;
+    using Clock = std::chrono::steady_clock;
+
+    struct Result {
+        std::string Name;
+        double Value;
+        std::string Unit;
+    };
+
+    template <typename Func>
+    static double Run(const std::string& name,
+                      SizeType iterations,
+                      Func&& func);
+
+    static void Report(const std::string& name,
+                       double value,
+                       const std::string& unit) {
+        std::cout << std::left << std::setw(NAME_WIDTH) << name << std::right
+                  << std::setw(VALUE_WIDTH) << std::fixed
+                  << std::setprecision(3) << value << " " << unit
+                  << std::endl;
+        GetResults().push_back({name, value, unit});
+    }
+
+    static std::vector<Result>& GetResults() {
+        static std::vector<Result> results;
+        return results;
+    }
+
+    // Names are stable between commits, so two files can be joined on
+    // the first column
+    static bool WriteCsv(const std::string& path) {
+        std::ofstream file(path);
+        if (!file) {
+            return false;
+        }
+
+        file << "name,value,unit\n" << std::setprecision(6);
+        for (auto&& result : GetResults()) {
+            file << '"' << result.Name << "\"," << result.Value << ","
+                 << result.Unit << "\n";
+        }
+        return static_cast<bool>(file);
+    }
+
+private:
+    static constexpr int NAME_WIDTH = 56;
+    static constexpr int VALUE_WIDTH = 16;
+    static constexpr SizeType BATCH_COUNT = 5;
+};
+
+// Returns time of one iteration in microseconds: median over several
+// batches, so a single preempted batch doesn't move the result
+template <typename Func>
+double Benchmark::Run(const std::string& name,
+                      SizeType iterations,
+                      Func&& func) {
+    // warm up caches and lazily created resources
+    func();
+
+    const auto batchCount = std::max<SizeType>(
+        std::min<SizeType>(iterations, BATCH_COUNT), 1);
+    const auto batchSize = std::max<SizeType>(iterations / batchCount, 1);
+
+    std::vector<double> batches;
+    for (auto batch = 0UL; batch < batchCount; batch++) {
+        const auto start = Clock::now();
+        for (auto i = 0UL; i < batchSize; i++) {
+            func();
+        }
+        const auto stop = Clock::now();
+
+        const std::chrono::duration<double, std::micro> elapsed =
+            stop - start;
+        batches.push_back(elapsed.count() / batchSize);
+    }
+
+    std::sort(batches.begin(), batches.end());
+    const auto result = batches[batches.size() / 2];
+    Report(name, result, "us/call");
+    return result;
+}
+
+#endif  // CG_LAB_BENCHMARK_HPP_
@@ -0,0 +1,81 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <BenchFixture.hpp>
+#include <Benchmark.hpp>
+#include <MeshCache.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace BenchFixture;
+
+const SizeType CACHE_BYTES = 64 << 20;
+
+// Vertex counts of a slider dragged from 20 to 100 and back
+std::vector<SizeType> GenerateSliderSweep() {
+    std::vector<SizeType> sweep;
+    for (SizeType count = 20; count < 100; count += 4) {
+        sweep.push_back(count);
+    }
+    for (SizeType count = 100; count > 20; count -= 4) {
+        sweep.push_back(count);
+    }
+    return sweep;
+}
+
+void RunSweep(const std::vector<SizeType>& sweep,
+              Ellipsoid& ellipsoid,
+              MeshCache& cache) {
+    for (auto count : sweep) {
+        const auto key = MeshKey(ellipsoid, count, 100, false);
+        if (cache.Find(key) != nullptr) {
+            continue;
+        }
+        ellipsoid.SetVertexCount(count);
+        auto mesh = cache.TakeSpare();
+        ellipsoid.GenerateMesh(mesh.Arena);
+        const auto bytes = mesh.GetByteSize();
+        cache.Insert(key, std::move(mesh), bytes);
+    }
+}
+
+}  // namespace
+
+// Object space meshes of a slider sweep with and without the cache
+void RunCacheBenchmarks(Benchmark::SizeType iterations) {
+    const auto sweep = GenerateSliderSweep();
+    auto ellipsoid = Ellipsoid(A, B, C, 20, 100, VIEW_POINT);
+    const auto suffix =
+        "(" + std::to_string(sweep.size()) + " slider steps, surface=100)";
+
+    VertexArena arena;
+    Benchmark::Run("slider sweep, no cache " + suffix, iterations, [&]() {
+        for (auto count : sweep) {
+            ellipsoid.SetVertexCount(count);
+            ellipsoid.GenerateMesh(arena);
+        }
+    });
+
+    MeshCache cache(CACHE_BYTES);
+    Benchmark::Run("slider sweep, LRU cache " + suffix, iterations,
+                   [&]() { RunSweep(sweep, ellipsoid, cache); });
+
+    const auto& counters = cache.GetCounters();
+    const double lookups = counters.Hits + counters.Misses;
+    Benchmark::Report("mesh cache hit rate " + suffix,
+                      100.0 * counters.Hits / lookups, "%");
+    Benchmark::Report("mesh cache memory " + suffix,
+                      cache.GetByteSize() / 1048576.0, "MiB");
+
+    // A budget of a few meshes makes the sweep evict all the time
+    MeshCache smallCache(CACHE_BYTES / 32);
+    Benchmark::Run("slider sweep, 2 MiB LRU cache " + suffix, iterations,
+                   [&]() { RunSweep(sweep, ellipsoid, smallCache); });
+    Benchmark::Report("mesh cache evictions, 2 MiB " + suffix,
+                      smallCache.GetCounters().Evictions, "meshes");
+}
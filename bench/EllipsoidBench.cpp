@@ -0,0 +1,153 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <BenchFixture.hpp>
+#include <Benchmark.hpp>
+#include <Ellipsoid.hpp>
+
+#include <cmath>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace BenchFixture;
+
+// Layer generation the way it was done before the thread pool:
+// one freshly started thread per side layer on every call
+LayerVector GenerateWithAsync(SizeType vertexCount, SizeType surfaceCount) {
+    const Mat4x4 rotateMatrix = Mat4x4::Identity();
+    const float start = -0.1f;
+    const float stop = 0.1f;
+    const float delta = (stop - start) / surfaceCount;
+    const auto ring = RingTable(vertexCount);
+
+    std::vector<std::future<Layer>> futures;
+    for (auto height = start; height <= stop; height += delta) {
+        futures.emplace_back(std::async(std::launch::async, [=, &ring]() {
+            return Layer(A, B, C, height, ring, delta, rotateMatrix,
+                         VIEW_POINT);
+        }));
+    }
+
+    LayerVector layers;
+    for (auto&& future : futures) {
+        layers.emplace_back(future.get());
+    }
+    return layers;
+}
+
+SizeType GetTriangleCount(const LayerVector& layers) {
+    SizeType result = 0;
+    for (auto&& layer : layers) {
+        result += layer.GetItemsCount() / 3;
+    }
+    return result;
+}
+
+SizeType GetByteSize(const LayerVector& layers) {
+    SizeType result = 0;
+    for (auto&& layer : layers) {
+        result += layer.GetItemsCount() * sizeof(Vertex);
+    }
+    return result;
+}
+
+}  // namespace
+
+void RunEllipsoidBenchmarks(Benchmark::SizeType iterations) {
+    const Mat4x4 rotateMatrix = Mat4x4::Identity();
+
+    for (auto surfaceCount : {3UL, 60UL, 100UL}) {
+        const auto suffix = "(vertex=4, surface=" +
+                            std::to_string(surfaceCount) + ")";
+        // Tiny layers make the per-call scheduling overhead dominant
+        auto ellipsoid = Ellipsoid(A, B, C, 4, surfaceCount, VIEW_POINT);
+
+        Benchmark::Run("std::async per layer " + suffix, iterations,
+                       [=]() { GenerateWithAsync(4, surfaceCount); });
+        Benchmark::Run("thread pool " + suffix, iterations,
+                       [&]() { ellipsoid.GenerateVertices(rotateMatrix); });
+    }
+
+    // Dense rings make vertex generation itself dominant
+    for (auto vertexCount : {1000UL, 10000UL}) {
+        const auto suffix = "(vertex=" + std::to_string(vertexCount) +
+                            ", surface=20)";
+        auto ellipsoid = Ellipsoid(A, B, C, vertexCount, 20, VIEW_POINT);
+
+        Benchmark::Run("culled layers " + suffix, iterations,
+                       [&]() { ellipsoid.GenerateVertices(rotateMatrix); });
+        Benchmark::Run("indexed mesh " + suffix, iterations,
+                       [&]() { ellipsoid.GenerateIndexedMesh(); });
+    }
+}
+
+void RunMeshMemoryReport() {
+    for (auto [vertexCount, surfaceCount] :
+         {std::pair{20UL, 60UL}, {100UL, 100UL}, {1000UL, 100UL}}) {
+        const auto suffix = "(vertex=" + std::to_string(vertexCount) +
+                            ", surface=" + std::to_string(surfaceCount) + ")";
+        auto ellipsoid =
+            Ellipsoid(A, B, C, vertexCount, surfaceCount, VIEW_POINT);
+
+        const auto soupBytes = GetByteSize(ellipsoid.GenerateMesh());
+        const auto mesh = ellipsoid.GenerateIndexedMesh();
+        const auto indexedBytes = mesh.GetByteSize();
+
+        Benchmark::Report("triangle soup " + suffix, soupBytes / 1024.0, "KiB");
+        Benchmark::Report("indexed mesh " + suffix, indexedBytes / 1024.0,
+                          mesh.HasShortIndices() ? "KiB (16-bit indices)"
+                                                 : "KiB (32-bit indices)");
+        Benchmark::Report("memory saved " + suffix,
+                          1.0 * soupBytes / indexedBytes, "x");
+
+        const auto packedBytes =
+            indexedBytes - mesh.GetVertices().size() *
+                               (sizeof(Vertex) - sizeof(PackedVertex));
+        Benchmark::Report("indexed packed mesh " + suffix,
+                          packedBytes / 1024.0, "KiB");
+    }
+}
+
+void RunCullingBenchmarks(Benchmark::SizeType iterations) {
+    const auto VIEW_COUNT = 16;
+    const auto PI = 4 * std::atan(1.0f);
+
+    for (auto [vertexCount, surfaceCount] :
+         {std::pair{20UL, 60UL}, {100UL, 100UL}}) {
+        const auto suffix = "(vertex=" + std::to_string(vertexCount) +
+                            ", surface=" + std::to_string(surfaceCount) + ")";
+        auto ellipsoid =
+            Ellipsoid(A, B, C, vertexCount, surfaceCount, VIEW_POINT);
+
+        // CPU culling regenerates the geometry on every view change
+        SizeType culledTriangles = 0;
+        for (auto i = 0; i < VIEW_COUNT; i++) {
+            const auto angle = 2 * PI * i / VIEW_COUNT;
+            culledTriangles += GetTriangleCount(
+                ellipsoid.GenerateVertices(GenerateRotateMatrix(angle)));
+        }
+        Benchmark::Report("cpu culled triangles " + suffix,
+                          1.0 * culledTriangles / VIEW_COUNT, "per view");
+
+        auto view = 0;
+        Benchmark::Run("cpu culling, view change " + suffix, iterations,
+                       [&]() {
+                           const auto angle = 2 * PI * view++ / VIEW_COUNT;
+                           ellipsoid.GenerateVertices(
+                               GenerateRotateMatrix(angle));
+                       });
+
+        // GPU culling builds the closed mesh once, a view change is
+        // a uniform update only
+        Benchmark::Report("gpu culled triangles submitted " + suffix,
+                          GetTriangleCount(ellipsoid.GenerateMesh()),
+                          "per view");
+        Benchmark::Run("gpu culling, mesh build (once) " + suffix, iterations,
+                       [&]() { ellipsoid.GenerateMesh(); });
+    }
+}
@@ -0,0 +1,72 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <BenchFixture.hpp>
+#include <Benchmark.hpp>
+#include <Ellipsoid.hpp>
+
+#include <cmath>
+#include <string>
+
+namespace {
+
+using namespace BenchFixture;
+
+// Tilted view, so culling keeps roughly a half of every layer
+Mat4x4 GenerateViewMatrix() {
+    return GenerateRotateMatrix(0.5f);
+}
+
+std::string GetSuffix(SizeType vertexCount) {
+    return "(vertex=" + std::to_string(vertexCount) + ")";
+}
+
+std::string GetSuffix(SizeType vertexCount, SizeType surfaceCount) {
+    return "(vertex=" + std::to_string(vertexCount) +
+           ", surface=" + std::to_string(surfaceCount) + ")";
+}
+
+}  // namespace
+
+void RunLayerBenchmarks(Benchmark::SizeType iterations) {
+    const Mat4x4 viewMatrix = GenerateViewMatrix();
+    const LenghtType height = 0;
+    const LenghtType deltaH = 0.01f;
+
+    for (auto vertexCount : {8UL, 32UL, 128UL, 512UL, 2048UL}) {
+        const auto ring = RingTable(vertexCount);
+        const auto suffix = GetSuffix(vertexCount);
+
+        Benchmark::Run("side layer, culled " + suffix, iterations, [&]() {
+            Layer(A, B, C, height, ring, deltaH, viewMatrix, VIEW_POINT);
+        });
+        Benchmark::Run("side layer, not culled " + suffix, iterations, [&]() {
+            Layer(A, B, C, height, ring, deltaH, viewMatrix, std::nullopt);
+        });
+        Benchmark::Run("bottom layer, culled " + suffix, iterations, [&]() {
+            Layer(A, B, C, -0.1f, ring, viewMatrix, VIEW_POINT);
+        });
+        Benchmark::Run("bottom layer, not culled " + suffix, iterations,
+                       [&]() {
+                           Layer(A, B, C, -0.1f, ring, viewMatrix,
+                                 std::nullopt);
+                       });
+    }
+}
+
+void RunGenerateVerticesBenchmarks(Benchmark::SizeType iterations) {
+    const Mat4x4 viewMatrix = GenerateViewMatrix();
+
+    for (auto vertexCount : {4UL, 20UL, 100UL}) {
+        for (auto surfaceCount : {3UL, 20UL, 60UL, 100UL}) {
+            const auto suffix = GetSuffix(vertexCount, surfaceCount);
+            auto ellipsoid =
+                Ellipsoid(A, B, C, vertexCount, surfaceCount, VIEW_POINT);
+
+            Benchmark::Run("GenerateVertices " + suffix, iterations,
+                           [&]() { ellipsoid.GenerateVertices(viewMatrix); });
+        }
+    }
+}
@@ -0,0 +1,49 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <BenchFixture.hpp>
+#include <Benchmark.hpp>
+#include <Ellipsoid.hpp>
+#include <LevelOfDetail.hpp>
+
+#include <sstream>
+#include <string>
+
+namespace {
+
+using namespace BenchFixture;
+
+SizeType GetTriangleCount(const LodLevel& level) {
+    const auto ellipsoid = Ellipsoid(A, B, C, level.VertexCount,
+                                     level.SurfaceCount, VIEW_POINT);
+    VertexArena arena;
+    ellipsoid.GenerateMesh(arena);
+    return arena.GetVertexCount() / 3;
+}
+
+}  // namespace
+
+// Levels chosen for the window scale factors and their triangle counts
+// compared with the fixed 100x100 mesh
+void RunLodReport() {
+    const auto fullTriangles =
+        GetTriangleCount({LevelOfDetail::MAX_VERTEX_COUNT,
+                          LevelOfDetail::MAX_SURFACE_COUNT});
+    const auto lod = LevelOfDetail(A, B, C);
+
+    // Pixels per unit of the 300x300 image at the given scale factor
+    for (auto scale : {0.25f, 0.5f, 1.0f, 3.0f, 6.0f, 12.0f, 24.0f}) {
+        const auto level = lod.Compute(scale * 150);
+        const auto triangles = GetTriangleCount(level);
+        std::ostringstream suffixStream;
+        suffixStream << "(scale=" << scale << ", vertex=" << level.VertexCount
+                     << ", surface=" << level.SurfaceCount << ")";
+        const auto suffix = suffixStream.str();
+
+        Benchmark::Report("LOD triangles " + suffix, triangles, "triangles");
+        Benchmark::Report("LOD triangles saved " + suffix,
+                          1.0 * fullTriangles / triangles, "x");
+    }
+}
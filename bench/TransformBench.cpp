@@ -0,0 +1,61 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <Benchmark.hpp>
+#include <Ellipsoid.hpp>
+#include <TransformKernel.hpp>
+
+#include <string>
+
+void RunTransformBenchmarks(Benchmark::SizeType iterations) {
+    const auto VERTEX_COUNT = 1UL << 16;
+
+    Mat4x4 matrix;
+    matrix << 0.8f, 0.6f, 0, 0,  // first line
+        -0.6f, 0.8f, 0, 0,       // second line
+        0, 0, 1, 0,              // third line
+        0, 0, 0, 1;              // fourth line
+
+    VertexVector vertices;
+    PositionArray positions(VERTEX_COUNT);
+    for (auto i = 0UL; i < VERTEX_COUNT; i++) {
+        const auto value = static_cast<float>(i) / VERTEX_COUNT;
+        vertices.emplace_back(value, 1 - value, value * value);
+        positions.Set(i, value, 1 - value, value * value);
+    }
+
+    // Former path: one 1x4 by 4x4 product per vertex with array copies
+    VertexVector result;
+    result.reserve(VERTEX_COUNT);
+    const auto perVertex =
+        Benchmark::Run("per-vertex Eigen transform (65536 vertices)",
+                       iterations, [&]() {
+                           result.clear();
+                           for (auto&& vertex : vertices) {
+                               result.emplace_back(vertex.GetPosition() *
+                                                   matrix);
+                           }
+                       });
+
+    PositionArray output;
+    const auto scalar =
+        Benchmark::Run("scalar SoA kernel (65536 vertices)", iterations, [&]() {
+            TransformKernel::TransformScalar(positions, matrix, output);
+        });
+    const auto simd = Benchmark::Run(
+        std::string(TransformKernel::GetInstructionSet()) +
+            " SoA kernel (65536 vertices)",
+        iterations,
+        [&]() { TransformKernel::Transform(positions, matrix, output); });
+
+    // vertices per microsecond are millions of vertices per second
+    Benchmark::Report("per-vertex Eigen transform", VERTEX_COUNT / perVertex,
+                      "Mvertices/s");
+    Benchmark::Report("scalar SoA kernel", VERTEX_COUNT / scalar,
+                      "Mvertices/s");
+    Benchmark::Report(std::string(TransformKernel::GetInstructionSet()) +
+                          " SoA kernel",
+                      VERTEX_COUNT / simd, "Mvertices/s");
+}
@@ -0,0 +1,748 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+// Headless frame time benchmark: renders the ellipsoid into an offscreen
+// framebuffer and reports percentiles of every frame stage. Works with
+// Mesa llvmpipe, so it runs on machines without GPU and display.
+
+#include <EllipsoidRenderer.hpp>
+#include <FrameCapture.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QFile>
+#include <QGuiApplication>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QSurfaceFormat>
+#include <QTextStream>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+    RenderOptions Render;
+    SizeType FrameCount = 300;
+    QSize FrameSize = QSize(800, 600);
+    std::vector<SizeType> VertexCounts = {20, 100};
+    std::vector<SizeType> SurfaceCounts = {60, 100};
+    std::vector<float> Scales = {3.0f};
+    // Used by the instanced mode only
+    std::vector<SizeType> InstanceCounts = {1, 10, 100, 1000, 10000, 100000};
+    double IdleSeconds = 0;
+    bool CompareImpostor = false;
+    bool Startup = false;
+    CaptureOptions Capture;
+    QString CsvPath;
+    QString JsonPath;
+};
+
+// Per-stage samples of one sweep point, milliseconds
+struct StageSamples {
+    std::vector<double> Generation;
+    std::vector<double> Upload;
+    std::vector<double> Draw;
+    std::vector<double> GpuFinish;
+    std::vector<double> GpuUpload;
+    std::vector<double> GpuDraw;
+    std::vector<double> Total;
+};
+
+struct StageSummary {
+    double P50;
+    double P90;
+    double P99;
+    double Mean;
+};
+
+struct SweepResult {
+    SizeType VertexCount;
+    SizeType SurfaceCount;
+    float Scale;
+    SizeType InstanceCount;
+    SizeType TriangleCount;
+    QVector<QPair<QString, StageSummary>> Stages;
+};
+
+const float PI = 4.0f * std::atan(1.0f);
+
+const float A = 1.1f;
+const float B = 1.5f;
+const float C = 0.2f;
+
+template <typename T>
+std::vector<T> ParseList(const QString& value) {
+    std::vector<T> result;
+    for (auto&& item : value.split(',', QString::SkipEmptyParts)) {
+        bool ok = false;
+        const auto number = item.trimmed().toDouble(&ok);
+        if (ok) {
+            result.push_back(static_cast<T>(number));
+        } else {
+            qWarning() << "Ignoring bad list item" << item;
+        }
+    }
+    return result;
+}
+
+// Nearest rank percentile of sorted samples
+double GetPercentile(const std::vector<double>& sorted, double percent) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    const auto rank = static_cast<SizeType>(
+        std::ceil(percent / 100.0 * sorted.size()));
+    return sorted[std::max<SizeType>(rank, 1) - 1];
+}
+
+StageSummary Summarize(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0;
+    for (auto&& sample : samples) {
+        sum += sample;
+    }
+
+    StageSummary summary;
+    summary.P50 = GetPercentile(samples, 50);
+    summary.P90 = GetPercentile(samples, 90);
+    summary.P99 = GetPercentile(samples, 99);
+    summary.Mean = samples.empty() ? 0 : sum / samples.size();
+    return summary;
+}
+
+double GetElapsedTime(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+}
+
+BenchmarkOptions ParseOptions(const QGuiApplication& app) {
+    const QMap<QString, RenderMode> renderModes = {
+        {"cpu", RenderMode::CPU_TRANSFORM},
+        {"gpu", RenderMode::GPU_TRANSFORM},
+        {"indexed", RenderMode::INDEXED},
+        {"instanced", RenderMode::INSTANCED},
+        {"procedural", RenderMode::PROCEDURAL},
+        {"tessellated", RenderMode::TESSELLATED},
+        {"impostor", RenderMode::IMPOSTOR}};
+    const QMap<QString, CaptureOptions::Format> captureFormats = {
+        {"png", CaptureOptions::Format::PNG},
+        {"raw", CaptureOptions::Format::RAW}};
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Offscreen frame time benchmark");
+    parser.addHelpOption();
+
+    QCommandLineOption framesOption("frames", "Frames per sweep point.",
+                                    "count", "300");
+    QCommandLineOption widthOption("width", "Framebuffer width.", "pixels",
+                                   "800");
+    QCommandLineOption heightOption("height", "Framebuffer height.",
+                                    "pixels", "600");
+    QCommandLineOption renderModeOption(
+        "render-mode",
+        "Rendering mode: " + QStringList(renderModes.keys()).join(", ") + ".",
+        "mode", "cpu");
+    QCommandLineOption packedVerticesOption(
+        "packed-vertices", "Upload 16 bytes vertices with packed normals.");
+    QCommandLineOption asyncOption(
+        "async-generation",
+        "Generate meshes on a background thread. Frames draw the newest "
+        "finished mesh, generate reports its build time.");
+    QCommandLineOption adaptiveLodOption(
+        "adaptive-lod",
+        "Choose counts from the on-screen size, vertex and surface counts "
+        "are ignored.");
+    QCommandLineOption vertexOption("vertex-counts",
+                                    "Comma separated vertex counts.", "list",
+                                    "20,100");
+    QCommandLineOption surfaceOption("surface-counts",
+                                     "Comma separated surface counts.",
+                                     "list", "60,100");
+    QCommandLineOption scaleOption("scales", "Comma separated scale factors.",
+                                   "list", "3");
+    QCommandLineOption instanceOption(
+        "instance-counts",
+        "Comma separated instance counts of the instanced and impostor "
+        "modes.",
+        "list",
+        "1,10,100,1000,10000,100000");
+    QCommandLineOption idleOption(
+        "idle-seconds",
+        "Measure CPU usage of the idle colour animation for given seconds "
+        "per variant instead of frame times.",
+        "seconds", "0");
+    QCommandLineOption compareImpostorOption(
+        "compare-impostor",
+        "Compare frame time, fill rate and image difference of the "
+        "impostor and the tessellated modes per scale instead of the sweep.");
+    QCommandLineOption startupOption(
+        "startup",
+        "Measure renderer initialization and the first frame with shaders "
+        "compiled, cached for the first time and loaded from the cache "
+        "instead of the sweep.");
+    QCommandLineOption captureDirOption(
+        "capture-dir",
+        "Capture the colour animation to the directory and compare frame "
+        "rates with synchronous readback instead of the sweep.",
+        "dir");
+    QCommandLineOption captureFormatOption(
+        "capture-format",
+        "Format of captured frames: " +
+            QStringList(captureFormats.keys()).join(", ") + ".",
+        "format", "png");
+    QCommandLineOption csvOption("csv", "Write results as CSV.", "file");
+    QCommandLineOption jsonOption("json", "Write results as JSON.", "file");
+
+    parser.addOptions({framesOption, widthOption, heightOption,
+                       renderModeOption, packedVerticesOption, asyncOption,
+                       adaptiveLodOption, vertexOption, surfaceOption,
+                       scaleOption, instanceOption, idleOption,
+                       compareImpostorOption, startupOption, captureDirOption,
+                       captureFormatOption, csvOption, jsonOption});
+    parser.process(app);
+
+    BenchmarkOptions options;
+    const auto mode = parser.value(renderModeOption);
+    if (renderModes.contains(mode)) {
+        options.Render.Mode = renderModes.value(mode);
+    } else {
+        qWarning() << "Unknown render mode" << mode << ", using cpu";
+    }
+    options.Render.PackedVertices = parser.isSet(packedVerticesOption);
+    options.Render.AdaptiveLod = parser.isSet(adaptiveLodOption);
+    options.Render.AsyncGeneration = parser.isSet(asyncOption);
+    options.FrameCount =
+        std::max(parser.value(framesOption).toULong(), 1UL);
+    options.FrameSize = QSize(std::max(parser.value(widthOption).toInt(), 1),
+                              std::max(parser.value(heightOption).toInt(), 1));
+    options.VertexCounts = ParseList<SizeType>(parser.value(vertexOption));
+    options.SurfaceCounts = ParseList<SizeType>(parser.value(surfaceOption));
+    options.Scales = ParseList<float>(parser.value(scaleOption));
+    options.InstanceCounts = ParseList<SizeType>(parser.value(instanceOption));
+    options.IdleSeconds = parser.value(idleOption).toDouble();
+    options.CompareImpostor = parser.isSet(compareImpostorOption);
+    options.Startup = parser.isSet(startupOption);
+    options.Capture.Directory = parser.value(captureDirOption);
+    const auto format = parser.value(captureFormatOption);
+    if (captureFormats.contains(format)) {
+        options.Capture.ImageFormat = captureFormats.value(format);
+    } else {
+        qWarning() << "Unknown capture format" << format << ", using png";
+    }
+    options.CsvPath = parser.value(csvOption);
+    options.JsonPath = parser.value(jsonOption);
+
+    return options;
+}
+
+SweepResult RunSweepPoint(QOpenGLFunctions& gl,
+                          EllipsoidRenderer& renderer,
+                          const BenchmarkOptions& options,
+                          SizeType vertexCount,
+                          SizeType surfaceCount,
+                          float scale,
+                          SizeType instanceCount) {
+    auto render = options.Render;
+    render.InstanceCount = instanceCount;
+    renderer.SetRenderOptions(render);
+    renderer.SetVertexCount(vertexCount);
+    renderer.SetSurfaceCount(surfaceCount);
+    renderer.SetScaleFactor(scale);
+
+    const auto width = options.FrameSize.width();
+    const auto height = options.FrameSize.height();
+
+    StageSamples samples;
+    // The first frame uploads the new mesh, it isn't a steady state one
+    for (auto frame = 0UL; frame <= options.FrameCount; frame++) {
+        renderer.SetAngle(EllipsoidRenderer::OY,
+                          2 * PI * frame / options.FrameCount);
+
+        const auto start = Clock::now();
+        renderer.Update(width, height);
+        renderer.Render();
+        const auto finishStart = Clock::now();
+        gl.glFinish();
+        const auto gpuFinish = GetElapsedTime(finishStart);
+        const auto total = GetElapsedTime(start);
+
+        if (frame == 0) {
+            continue;
+        }
+
+        const auto& statistics = renderer.GetFrameStatistics();
+        samples.Generation.push_back(statistics.GenerationTime);
+        samples.Upload.push_back(statistics.UploadTime);
+        samples.Draw.push_back(statistics.DrawTime);
+        samples.GpuFinish.push_back(gpuFinish);
+        samples.Total.push_back(total);
+        // Timer queries are read one frame later here, the first result
+        // belongs to the skipped frame
+        if (frame > 1 && statistics.GpuDrawTime >= 0) {
+            samples.GpuUpload.push_back(statistics.GpuUploadTime);
+            samples.GpuDraw.push_back(statistics.GpuDrawTime);
+        }
+    }
+
+    // Counts actually drawn, they differ from the requested ones with LOD
+    const auto level = renderer.GetLevel();
+    const auto& statistics = renderer.GetFrameStatistics();
+    SweepResult result{level.VertexCount,
+                       level.SurfaceCount,
+                       scale,
+                       statistics.InstanceCount,
+                       statistics.TriangleCount,
+                       {}};
+    result.Stages = {{"generate", Summarize(samples.Generation)},
+                     {"upload", Summarize(samples.Upload)},
+                     {"draw", Summarize(samples.Draw)},
+                     {"gpu_finish", Summarize(samples.GpuFinish)},
+                     {"gpu_upload", Summarize(samples.GpuUpload)},
+                     {"gpu_draw", Summarize(samples.GpuDraw)},
+                     {"total", Summarize(samples.Total)}};
+    return result;
+}
+
+// Process CPU time of an idle animated scene ticking every 100 ms,
+// percents of one core
+double MeasureIdleCpuUsage(QOpenGLFunctions& gl,
+                           EllipsoidRenderer& renderer,
+                           const BenchmarkOptions& options,
+                           bool rebuildGeometry) {
+    const auto TICK = std::chrono::milliseconds(100);
+    const auto width = options.FrameSize.width();
+    const auto height = options.FrameSize.height();
+
+    const auto wallStart = Clock::now();
+    const auto cpuStart = std::clock();
+    auto tick = wallStart;
+    while (GetElapsedTime(wallStart) < options.IdleSeconds * 1000) {
+        if (rebuildGeometry) {
+            // What every tick did before: the whole mesh was rebuilt
+            renderer.SetRenderOptions(options.Render);
+        }
+        renderer.SetTime(GetElapsedTime(wallStart) / 1000);
+        renderer.Update(width, height);
+        renderer.Render();
+        gl.glFinish();
+
+        tick += TICK;
+        std::this_thread::sleep_until(tick);
+    }
+
+    const auto cpuTime = 1000.0 * (std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    return 100 * cpuTime / GetElapsedTime(wallStart);
+}
+
+// Pixels that differ from the background
+SizeType CountCoveredPixels(const QImage& image) {
+    SizeType count = 0;
+    for (auto y = 0; y < image.height(); y++) {
+        const auto line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (auto x = 0; x < image.width(); x++) {
+            count += (line[x] & RGB_MASK) != 0;
+        }
+    }
+    return count;
+}
+
+// Percent of pixels covered by either image whose channels differ by
+// more than the threshold
+double GetMismatch(const QImage& first, const QImage& second, int threshold) {
+    SizeType covered = 0;
+    SizeType different = 0;
+    for (auto y = 0; y < first.height(); y++) {
+        const auto firstLine =
+            reinterpret_cast<const QRgb*>(first.constScanLine(y));
+        const auto secondLine =
+            reinterpret_cast<const QRgb*>(second.constScanLine(y));
+        for (auto x = 0; x < first.width(); x++) {
+            const auto a = firstLine[x];
+            const auto b = secondLine[x];
+            if (((a | b) & RGB_MASK) == 0) {
+                continue;
+            }
+            covered++;
+            different += std::abs(qRed(a) - qRed(b)) > threshold ||
+                         std::abs(qGreen(a) - qGreen(b)) > threshold ||
+                         std::abs(qBlue(a) - qBlue(b)) > threshold;
+        }
+    }
+    return covered == 0 ? 0 : 100.0 * different / covered;
+}
+
+// Draws one ellipsoid with the tessellated mode as the reference and
+// with impostors. Both trace the same surface, so the mismatch shows
+// how close the tessellation at LodPixelError gets to the exact one.
+void CompareImpostor(QOpenGLFunctions& gl,
+                     EllipsoidRenderer& renderer,
+                     QOpenGLFramebufferObject& framebuffer,
+                     const BenchmarkOptions& options) {
+    const auto MISMATCH_THRESHOLD = 8;
+    // Counts of the indexed mesh drawn without tessellation support
+    const auto FALLBACK_COUNT = 100UL;
+    const QMap<QString, RenderMode> modes = {
+        {"tessellated", RenderMode::TESSELLATED},
+        {"impostor", RenderMode::IMPOSTOR}};
+    auto getStage = [](const SweepResult& result, const QString& name) {
+        for (auto&& stage : result.Stages) {
+            if (stage.first == name) {
+                return stage.second;
+            }
+        }
+        return StageSummary{};
+    };
+    QTextStream out(stdout);
+
+    for (auto scale : options.Scales) {
+        QImage reference;
+        // The reference goes first
+        for (auto&& name : {"tessellated", "impostor"}) {
+            auto compared = options;
+            compared.Render.Mode = modes.value(name);
+            const auto result =
+                RunSweepPoint(gl, renderer, compared, FALLBACK_COUNT,
+                              FALLBACK_COUNT, scale, 1);
+            // The last frame has the same angle in both modes
+            const auto image = framebuffer.toImage();
+            if (reference.isNull()) {
+                reference = image;
+            }
+
+            const auto total = getStage(result, "total");
+            const auto gpuDraw = getStage(result, "gpu_draw");
+            const auto covered = CountCoveredPixels(image);
+            // GPU draw time when timer queries work, frame time otherwise
+            const auto drawTime = gpuDraw.P50 > 0 ? gpuDraw.P50 : total.P50;
+            out << name << ", scale " << scale << ": frame p50 " << total.P50
+                << " ms, gpu draw p50 " << gpuDraw.P50 << " ms, covered "
+                << covered << " px, fill rate "
+                << covered / drawTime / 1000 << " Mpx/s, mismatch "
+                << GetMismatch(reference, image, MISMATCH_THRESHOLD)
+                << " %\n";
+        }
+    }
+    out.flush();
+}
+
+// Initialization and time to the first finished frame of a new renderer
+// without the shader cache, then twice with it. The first cached run
+// compiles and stores programs unless an earlier process did it.
+void MeasureStartup(QOpenGLFunctions& gl, const BenchmarkOptions& options) {
+    const auto width = options.FrameSize.width();
+    const auto height = options.FrameSize.height();
+    QTextStream out(stdout);
+
+    for (auto cacheShaders : {false, true, true}) {
+        const auto start = Clock::now();
+        EllipsoidRenderer renderer(A, B, C, 20, 60);
+        auto render = options.Render;
+        render.CacheShaders = cacheShaders;
+        renderer.SetRenderOptions(render);
+        if (!renderer.Initialize()) {
+            return;
+        }
+        renderer.Update(width, height);
+        renderer.Render();
+        gl.glFinish();
+        const auto firstFrame = GetElapsedTime(start);
+
+        const auto& shaders = renderer.GetShaderCache();
+        const auto& counters = shaders.GetCounters();
+        out << "shader cache " << (shaders.IsEnabled() ? "on" : "off")
+            << ": initialize " << renderer.GetInitializationTime()
+            << " ms, first frame " << firstFrame << " ms, "
+            << counters.Loaded << " loaded, " << counters.Compiled
+            << " compiled, " << counters.Rejected << " rejected\n";
+        renderer.CleanUp();
+    }
+    out.flush();
+}
+
+// Frames per second of FrameCount animation frames: rendering only,
+// read back synchronously as QOpenGLWidget::grabFramebuffer does, and
+// captured to files through FrameCapture
+void RunCapture(QOpenGLFunctions& gl,
+                EllipsoidRenderer& renderer,
+                QOpenGLFramebufferObject& framebuffer,
+                const BenchmarkOptions& options) {
+    // Animation time step of a captured frame
+    const auto FRAME_TIME = 1 / 30.0f;
+    const auto width = options.FrameSize.width();
+    const auto height = options.FrameSize.height();
+
+    // The first values of the lists are used
+    if (options.VertexCounts.empty() || options.SurfaceCounts.empty() ||
+        options.Scales.empty()) {
+        qWarning() << "Vertex, surface and scale lists must not be empty";
+        return;
+    }
+    renderer.SetVertexCount(options.VertexCounts.front());
+    renderer.SetSurfaceCount(options.SurfaceCounts.front());
+    renderer.SetScaleFactor(options.Scales.front());
+    // Uploads the mesh, the animation doesn't change it later
+    renderer.Update(width, height);
+    renderer.Render();
+    gl.glFinish();
+
+    auto renderFrame = [&](SizeType frame) {
+        renderer.SetTime(frame * FRAME_TIME);
+        renderer.Update(width, height);
+        renderer.Render();
+    };
+    auto getRate = [&](Clock::time_point start) {
+        return 1000 * options.FrameCount / GetElapsedTime(start);
+    };
+    QTextStream out(stdout);
+
+    auto start = Clock::now();
+    for (auto frame = 0UL; frame < options.FrameCount; frame++) {
+        renderFrame(frame);
+    }
+    gl.glFinish();
+    out << "render only: " << getRate(start) << " fps\n";
+
+    start = Clock::now();
+    for (auto frame = 0UL; frame < options.FrameCount; frame++) {
+        renderFrame(frame);
+        // Waits for the frame, the result isn't encoded
+        framebuffer.toImage();
+    }
+    out << "synchronous readback: " << getRate(start) << " fps\n";
+
+    FrameCapture capture(options.Capture);
+    if (!capture.Initialize()) {
+        return;
+    }
+    start = Clock::now();
+    for (auto frame = 0UL; frame < options.FrameCount; frame++) {
+        renderFrame(frame);
+        capture.Capture(width, height);
+    }
+    capture.Finish();
+    const auto counters = capture.GetCounters();
+    out << "asynchronous capture to " << options.Capture.Directory << ": "
+        << getRate(start) << " fps, " << counters.Written << " frames, "
+        << counters.GpuStalls << " GPU stalls, " << counters.WriterStalls
+        << " writer stalls\n";
+    capture.CleanUp();
+    out.flush();
+}
+
+void PrintResult(const SweepResult& result) {
+    QTextStream out(stdout);
+    out << "vertex " << result.VertexCount << ", surface "
+        << result.SurfaceCount << ", scale " << result.Scale
+        << ", instances " << result.InstanceCount << ", triangles "
+        << result.TriangleCount << "\n";
+    for (auto&& stage : result.Stages) {
+        out << QString("    %1 %2 %3 %4 %5 ms (p50 p90 p99 mean)\n")
+                   .arg(stage.first, -12)
+                   .arg(stage.second.P50, 10, 'f', 3)
+                   .arg(stage.second.P90, 10, 'f', 3)
+                   .arg(stage.second.P99, 10, 'f', 3)
+                   .arg(stage.second.Mean, 10, 'f', 3);
+    }
+    out.flush();
+}
+
+bool WriteCsv(const QString& path, const std::vector<SweepResult>& results) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "Cannot open" << path;
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "vertex_count,surface_count,scale,instance_count,triangle_count,"
+           "stage,p50_ms,p90_ms,p99_ms,mean_ms\n";
+    for (auto&& result : results) {
+        for (auto&& stage : result.Stages) {
+            out << result.VertexCount << "," << result.SurfaceCount << ","
+                << result.Scale << "," << result.InstanceCount << ","
+                << result.TriangleCount << "," << stage.first << ","
+                << stage.second.P50 << "," << stage.second.P90 << ","
+                << stage.second.P99 << "," << stage.second.Mean << "\n";
+        }
+    }
+    return true;
+}
+
+bool WriteJson(const QString& path,
+               const BenchmarkOptions& options,
+               const std::vector<SweepResult>& results) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot open" << path;
+        return false;
+    }
+
+    QJsonArray points;
+    for (auto&& result : results) {
+        QJsonObject stages;
+        for (auto&& stage : result.Stages) {
+            stages[stage.first] = QJsonObject{{"p50_ms", stage.second.P50},
+                                              {"p90_ms", stage.second.P90},
+                                              {"p99_ms", stage.second.P99},
+                                              {"mean_ms", stage.second.Mean}};
+        }
+        points.append(QJsonObject{
+            {"vertex_count", static_cast<qint64>(result.VertexCount)},
+            {"surface_count", static_cast<qint64>(result.SurfaceCount)},
+            {"scale", result.Scale},
+            {"instance_count", static_cast<qint64>(result.InstanceCount)},
+            {"triangle_count", static_cast<qint64>(result.TriangleCount)},
+            {"stages", stages}});
+    }
+
+    const QJsonObject root{
+        {"frames", static_cast<qint64>(options.FrameCount)},
+        {"width", options.FrameSize.width()},
+        {"height", options.FrameSize.height()},
+        {"packed_vertices", options.Render.PackedVertices},
+        {"adaptive_lod", options.Render.AdaptiveLod},
+        {"renderer", QString(reinterpret_cast<const char*>(
+                         QOpenGLContext::currentContext()->functions()
+                             ->glGetString(GL_RENDERER)))},
+        {"points", points}};
+    file.write(QJsonDocument(root).toJson());
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    // Prefer llvmpipe so numbers don't depend on the local GPU
+    if (qEnvironmentVariableIsEmpty("LIBGL_ALWAYS_SOFTWARE")) {
+        qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+    }
+
+    QGuiApplication app(argc, argv);
+    Q_INIT_RESOURCE(resources);
+
+    const auto options = ParseOptions(app);
+
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+    format.setStencilBufferSize(8);
+
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create()) {
+        qCritical() << "Cannot create OpenGL context";
+        return EXIT_FAILURE;
+    }
+
+    QOffscreenSurface surface;
+    surface.setFormat(context.format());
+    surface.create();
+    if (!context.makeCurrent(&surface)) {
+        qCritical() << "Cannot make OpenGL context current";
+        return EXIT_FAILURE;
+    }
+
+    QOpenGLFramebufferObject framebuffer(
+        options.FrameSize, QOpenGLFramebufferObject::CombinedDepthStencil);
+    framebuffer.bind();
+
+    auto gl = context.functions();
+    gl->glViewport(0, 0, options.FrameSize.width(),
+                   options.FrameSize.height());
+    qInfo() << "Renderer:"
+            << reinterpret_cast<const char*>(gl->glGetString(GL_RENDERER));
+
+    if (options.Startup) {
+        MeasureStartup(*gl, options);
+        framebuffer.release();
+        context.doneCurrent();
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<SweepResult> results;
+    {
+        EllipsoidRenderer renderer(A, B, C, 20, 60);
+        renderer.SetRenderOptions(options.Render);
+        if (!renderer.Initialize()) {
+            return EXIT_FAILURE;
+        }
+
+        if (options.IdleSeconds > 0) {
+            renderer.Update(options.FrameSize.width(),
+                            options.FrameSize.height());
+            QTextStream out(stdout);
+            out << "idle animation, rebuild per tick: "
+                << MeasureIdleCpuUsage(*gl, renderer, options, true)
+                << " % CPU\n";
+            out << "idle animation, time uniform per tick: "
+                << MeasureIdleCpuUsage(*gl, renderer, options, false)
+                << " % CPU\n";
+            renderer.CleanUp();
+            return EXIT_SUCCESS;
+        }
+
+        if (options.CompareImpostor) {
+            CompareImpostor(*gl, renderer, framebuffer, options);
+            renderer.CleanUp();
+            return EXIT_SUCCESS;
+        }
+
+        if (!options.Capture.Directory.isEmpty()) {
+            RunCapture(*gl, renderer, framebuffer, options);
+            renderer.CleanUp();
+            return EXIT_SUCCESS;
+        }
+
+        // Other modes draw one ellipsoid whatever the list is
+        const auto instanceCounts =
+            options.Render.Mode == RenderMode::INSTANCED ||
+                    options.Render.Mode == RenderMode::IMPOSTOR
+                ? options.InstanceCounts
+                : std::vector<SizeType>{1};
+        for (auto vertexCount : options.VertexCounts) {
+            for (auto surfaceCount : options.SurfaceCounts) {
+                for (auto scale : options.Scales) {
+                    for (auto instanceCount : instanceCounts) {
+                        results.push_back(RunSweepPoint(
+                            *gl, renderer, options, vertexCount,
+                            surfaceCount, scale, instanceCount));
+                        PrintResult(results.back());
+                    }
+                }
+            }
+        }
+
+        if (!options.CsvPath.isEmpty()) {
+            WriteCsv(options.CsvPath, results);
+        }
+        if (!options.JsonPath.isEmpty()) {
+            WriteJson(options.JsonPath, options, results);
+        }
+
+        renderer.CleanUp();
+    }
+
+    framebuffer.release();
+    context.doneCurrent();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <Benchmark.hpp>
+
+#include <cstdlib>
+#include <iostream>
+
+void RunEllipsoidBenchmarks(Benchmark::SizeType iterations);
+void RunMeshMemoryReport();
+void RunCullingBenchmarks(Benchmark::SizeType iterations);
+void RunTransformBenchmarks(Benchmark::SizeType iterations);
+void RunLayerBenchmarks(Benchmark::SizeType iterations);
+void RunGenerateVerticesBenchmarks(Benchmark::SizeType iterations);
+bool RunArenaBenchmarks(Benchmark::SizeType iterations);
+void RunLodReport();
+void RunAsyncBenchmarks(Benchmark::SizeType iterations);
+void RunCacheBenchmarks(Benchmark::SizeType iterations);
+
+int main(int argc, char* argv[]) {
+    Benchmark::SizeType iterations = 200;
+    if (argc > 1) {
+        iterations = std::strtoul(argv[1], nullptr, 10);
+    }
+
+    RunEllipsoidBenchmarks(iterations);
+    RunMeshMemoryReport();
+    RunCullingBenchmarks(iterations);
+    RunTransformBenchmarks(iterations);
+    RunLayerBenchmarks(iterations);
+    RunGenerateVerticesBenchmarks(iterations);
+    // Checked at the end, so the whole report is still printed
+    const auto arenaAllocationFree = RunArenaBenchmarks(iterations);
+    RunLodReport();
+    RunAsyncBenchmarks(iterations);
+    RunCacheBenchmarks(iterations);
+
+    if (argc > 2 && !Benchmark::WriteCsv(argv[2])) {
+        std::cerr << "Cannot write " << argv[2] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return arenaAllocationFree ? 0 : EXIT_FAILURE;
+}
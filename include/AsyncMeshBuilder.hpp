@@ -0,0 +1,87 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_ASYNCMESHBUILDER_HPP_
+#define CG_LAB_ASYNCMESHBUILDER_HPP_
+
+#include <Ellipsoid.hpp>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+// Generates ellipsoid meshes on a background thread. A new request
+// replaces the queued one, so the worker always builds the latest
+// parameters. Finished meshes are handed over through a lock-free triple
+// buffer: the worker writes one buffer, the reader draws another and the
+// third holds the newest published mesh.
+class AsyncMeshBuilder {
+public:
+    using Callback = std::function<void()>;
+
+    struct MeshRequest {
+        SizeType VertexCount = 0;
+        SizeType SurfaceCount = 0;
+        // Build an IndexedMesh instead of a triangle soup
+        bool Indexed = false;
+        // Rotation baked into culled vertices, object space mesh without it
+        std::optional<Mat4x4> RotateMatrix;
+        // Tag of the caller, returned with the result
+        SizeType Id = 0;
+    };
+
+    struct MeshResult {
+        MeshRequest Request;
+        VertexArena Arena;
+        IndexedMesh Mesh;
+        // Generation time on the worker in milliseconds
+        double BuildTime = 0;
+    };
+
+    // onReady is called on the worker thread after every publication
+    AsyncMeshBuilder(const Ellipsoid& ellipsoid, Callback onReady);
+    ~AsyncMeshBuilder();
+
+    AsyncMeshBuilder(const AsyncMeshBuilder&) = delete;
+    AsyncMeshBuilder& operator=(const AsyncMeshBuilder&) = delete;
+
+    // Never waits for generation
+    void Request(const MeshRequest& request);
+    // Newest mesh published since the last call or nullptr. The result
+    // stays valid until the next call that returns a new one.
+    const MeshResult* Take();
+
+    // Requests replaced before the worker started them
+    SizeType GetCancelledCount() const { return CancelledCount; }
+
+private:
+    // Middle holds a buffer index and this bit when it wasn't taken yet
+    static constexpr unsigned FRESH = 1 << 2;
+    static constexpr unsigned INDEX_MASK = FRESH - 1;
+
+    void WorkerLoop();
+    void Build(const MeshRequest& request, MeshResult& result);
+
+    Ellipsoid Generator;
+    Callback OnReady;
+    std::array<MeshResult, 3> Buffers;
+    // Back is owned by the worker, Front by the reader
+    unsigned Back;
+    unsigned Front;
+    std::atomic<unsigned> Middle;
+    std::atomic<SizeType> CancelledCount;
+
+    std::mutex Mutex;
+    std::condition_variable Condition;
+    std::optional<MeshRequest> Pending;
+    bool Stopped;
+    std::thread Worker;
+};
+
+#endif  // CG_LAB_ASYNCMESHBUILDER_HPP_
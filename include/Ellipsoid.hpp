@@ -6,25 +6,39 @@
 #ifndef CG_LAB_ELLIPSOID_HPP_
 #define CG_LAB_ELLIPSOID_HPP_
 
+#include <GeometryTypes.hpp>
+#include <ThreadPool.hpp>
+#include <TransformKernel.hpp>
 #include <Vertex.hpp>
 
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <vector>
 
-#ifdef EIGEN3_INCLUDE_DIR
-#include <Eigen/Dense>
-#else
-#include <eigen3/Eigen/Dense>
-#endif
+using VertexVector = std::vector<Vertex>;
+using OptionalViewPoint = std::optional<Vec3>;
+
+// Cosines and sines of ring angles 2 * PI * i / n for i in [0, n].
+// Built once per vertex count and shared read-only by all layers.
+class RingTable {
+public:
+    using FloatVector = std::vector<float>;
 
-using Vec3 = Eigen::Matrix<float, 1, 3>;
-using Vec4 = Eigen::Matrix<float, 1, 4>;
-using Mat4x4 = Eigen::Matrix<float, 4, 4>;
-using Map4x4 = Eigen::Map<Eigen::Matrix<float, 4, 4, Eigen::RowMajor>>;
+    RingTable() = default;
+    explicit RingTable(SizeType n);
 
-using SizeType = std::size_t;
-using LenghtType = float;
-using VertexVector = std::vector<Vertex>;
+    SizeType GetSegmentCount() const { return SegmentCount; }
+    const FloatVector& GetCos() const { return Cos; }
+    const FloatVector& GetSin() const { return Sin; }
+
+private:
+    static const float PI;
+
+    SizeType SegmentCount = 0;
+    FloatVector Cos;
+    FloatVector Sin;
+};
 
 class Layer {
 public:
@@ -35,41 +49,63 @@ public:
           LenghtType b,
           LenghtType c,
           LenghtType h,
-          SizeType n,
+          const RingTable& ring,
           LenghtType deltaH,
           const Mat4x4& transformMatrix,
-          const Vec3& viewPoint);
+          const OptionalViewPoint& viewPoint);
     Layer(LenghtType a,
           LenghtType b,
           LenghtType c,
           LenghtType h,
-          SizeType n,
+          const RingTable& ring,
           const Mat4x4& transformMatrix,
-          const Vec3& viewPoint);
+          const OptionalViewPoint& viewPoint);
 
     const VertexVector& GetVertices() const;
     SizeType GetItemsCount() const;
     Layer ApplyMatrix(const Mat4x4& matrix) const;
     LayerType GetType() const { return Type; }
 
-private:
-    static const float PI;
+    // Upper bound of vertices of a layer with n ring segments
+    static SizeType GetMaxVertexCount(LayerType type, SizeType n);
+
+    // Write visible triangles of a layer to output, which must have room
+    // for GetMaxVertexCount vertices. Return the number of written ones.
+    static SizeType WriteVertices(LenghtType a,
+                                  LenghtType b,
+                                  LenghtType c,
+                                  LenghtType h,
+                                  const RingTable& ring,
+                                  LenghtType deltaH,
+                                  const Mat4x4& rotateMatrix,
+                                  const OptionalViewPoint& viewPoint,
+                                  Vertex* output);
+    static SizeType WriteVertices(LenghtType a,
+                                  LenghtType b,
+                                  LenghtType c,
+                                  LenghtType h,
+                                  const RingTable& ring,
+                                  const Mat4x4& rotateMatrix,
+                                  const OptionalViewPoint& viewPoint,
+                                  Vertex* output);
 
-    void GenerateVertices(LenghtType a,
-                          LenghtType b,
-                          LenghtType c,
-                          LenghtType h,
-                          SizeType n,
-                          LenghtType deltaH,
-                          const Mat4x4& rotateMatrix,
-                          const Vec3& viewPoint);
-    void GenerateVertices(LenghtType a,
-                          LenghtType b,
-                          LenghtType c,
-                          LenghtType h,
-                          SizeType n,
-                          const Mat4x4& rotateMatrix,
-                          const Vec3& viewPoint);
+private:
+    // Per thread scratch for ring positions, reused between layers
+    static PositionArray& GetScratchPositions(SizeType size);
+
+    // Writes n + 1 ring points, the last one repeats the first
+    static void GenerateRing(LenghtType a,
+                             LenghtType b,
+                             LenghtType c,
+                             LenghtType h,
+                             const RingTable& ring,
+                             SizeType offset,
+                             PositionArray& positions);
+    static SizeType AddTriangle(const Vec4& first,
+                                const Vec4& middle,
+                                const Vec4& last,
+                                const OptionalViewPoint& viewPoint,
+                                Vertex* output);
 
     static Vec3 ToVec3(const Vec4& vec) { return Vec3(vec[0], vec[1], vec[2]); }
     static Vec4 ToVec4(const Vec3& vec) {
@@ -78,7 +114,8 @@ private:
     static Vec3 GetNormal(const Vec4& first,
                           const Vec4& middle,
                           const Vec4& last);
-    static bool CheckNormal(const Vec3& normal, const Vec3& viewPoint);
+    static bool CheckNormal(const Vec3& normal,
+                            const OptionalViewPoint& viewPoint);
 
     VertexVector Vertices;
     LayerType Type;
@@ -86,23 +123,103 @@ private:
 
 using LayerVector = std::vector<Layer>;
 
+// Mesh with vertices shared between neighbouring triangles. Indices are
+// stored as 16-bit values when the vertex count allows it.
+class IndexedMesh {
+public:
+    using IndexVector = std::vector<std::uint32_t>;
+    using ShortIndexVector = std::vector<std::uint16_t>;
+
+    IndexedMesh() = default;
+    IndexedMesh(VertexVector&& vertices, const IndexVector& indices);
+
+    const VertexVector& GetVertices() const { return Vertices; }
+    const void* GetIndexData() const;
+    SizeType GetIndexCount() const;
+    SizeType GetIndexSize() const;
+    bool HasShortIndices() const { return !ShortIndices.empty(); }
+    SizeType GetByteSize() const;
+
+private:
+    VertexVector Vertices;
+    IndexVector Indices;
+    ShortIndexVector ShortIndices;
+};
+
+// Reusable storage for the layers of one ellipsoid. Every layer gets a
+// slot of its upper bound size, then visible vertices are compacted to
+// the front. Capacity is kept, so regenerating geometry of the same or
+// smaller size doesn't allocate.
+class VertexArena {
+public:
+    struct LayerRange {
+        SizeType Offset;
+        SizeType Count;
+    };
+    using RangeVector = std::vector<LayerRange>;
+
+    const Vertex* GetData() const { return Vertices.data(); }
+    SizeType GetVertexCount() const { return VertexCount; }
+    const RangeVector& GetLayers() const { return Layers; }
+    // Memory held, including the unused capacity
+    SizeType GetByteSize() const;
+
+    // Prepares layerCount empty slots and maxVertexCount vertices
+    void Reset(SizeType layerCount, SizeType maxVertexCount);
+    Vertex* GetSlot(SizeType offset) { return Vertices.data() + offset; }
+    void SetLayer(SizeType index, SizeType offset, SizeType count);
+    // Moves layers back to back, so vertices form one range
+    void Compact();
+
+private:
+    VertexVector Vertices;
+    RangeVector Layers;
+    SizeType VertexCount = 0;
+};
+
 class Ellipsoid {
 public:
+    // Heights of the first and the last ring
+    static constexpr LenghtType MIN_HEIGHT = -0.1f;
+    static constexpr LenghtType MAX_HEIGHT = 0.1f;
+
     Ellipsoid() = default;
+    // Layers are generated on pool, the shared ThreadPool::GetDefault()
+    // one when it's null
     Ellipsoid(LenghtType a,
               LenghtType b,
               LenghtType c,
               SizeType vertexCount,
               SizeType surfaceCount,
-              const Vec3& viewPoint);
+              const Vec3& viewPoint,
+              std::shared_ptr<ThreadPool> pool = nullptr);
 
     SizeType GetVertexCount() const;
+    LenghtType GetA() const { return A; }
+    LenghtType GetB() const { return B; }
+    LenghtType GetC() const { return C; }
+    const std::vector<LenghtType>& GetRingHeights() const { return Heights; }
     LayerVector GenerateVertices(const Mat4x4& rotateMatrix) const;
+    // Closed mesh in object space without back-face culling
+    LayerVector GenerateMesh() const;
+    IndexedMesh GenerateIndexedMesh() const;
+
+    // Same as above, but write into the arena without heap allocations
+    // once it has grown to the needed size
+    void GenerateVertices(const Mat4x4& rotateMatrix, VertexArena& arena) const;
+    void GenerateMesh(VertexArena& arena) const;
 
     void SetVertexCount(SizeType count);
     void SetSurfaceCount(SizeType count);
 
 private:
+    std::vector<LenghtType> GenerateRingHeights() const;
+    LayerVector GenerateLayers(const Mat4x4& rotateMatrix,
+                               const OptionalViewPoint& viewPoint) const;
+    void GenerateLayers(const Mat4x4& rotateMatrix,
+                        const OptionalViewPoint& viewPoint,
+                        VertexArena& arena) const;
+
     static LayerVector ApplyMatrix(const LayerVector& layers,
                                    const Mat4x4& matrix);
 
@@ -111,7 +228,10 @@ private:
     LenghtType C;
     SizeType VertexCount;
     SizeType SurfaceCount;
+    std::shared_ptr<const RingTable> Ring;
+    std::vector<LenghtType> Heights;
     Vec3 ViewPoint;
+    std::shared_ptr<ThreadPool> Pool;
 };
 
 #endif  // CG_LAB_ELLIPSOID_HPP_
@@ -0,0 +1,360 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_ELLIPSOIDRENDERER_HPP_
+#define CG_LAB_ELLIPSOIDRENDERER_HPP_
+
+#include <AsyncMeshBuilder.hpp>
+#include <Ellipsoid.hpp>
+#include <InstanceGrid.hpp>
+#include <LevelOfDetail.hpp>
+#include <MeshCache.hpp>
+#include <RenderOptions.hpp>
+#include <RollingAverage.hpp>
+#include <ShaderCache.hpp>
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <QOpenGLExtraFunctions>
+#include <QSize>
+
+class QOpenGLBuffer;
+class QOpenGLVertexArrayObject;
+class QOpenGLShaderProgram;
+
+// Draws the ellipsoid into the currently bound framebuffer. Doesn't
+// depend on widgets, so it's shared by the window and the headless
+// benchmark.
+class EllipsoidRenderer : protected QOpenGLExtraFunctions {
+public:
+    using FloatType = float;
+    using Clock = std::chrono::steady_clock;
+
+    enum RotateType { OX, OY, OZ };
+
+    // Stages invalidated by parameter changes
+    enum DirtyFlag : unsigned {
+        CLEAN = 0,
+        GEOMETRY = 1 << 0,   // tessellation params and render mode
+        TRANSFORM = 1 << 1,  // angles, scale and viewport size
+        LIGHTING = 1 << 2,   // light coefficients
+        ANIMATION = 1 << 3,  // animation time
+        ALL = GEOMETRY | TRANSFORM | LIGHTING | ANIMATION
+    };
+
+    // Times of frame stages in milliseconds. CPU ones are measured with
+    // a steady clock, GPU ones with timer queries a few frames later, so
+    // they are negative until the first result arrives or without
+    // timer query support.
+    struct FrameStatistics {
+        double GenerationTime = 0;
+        double UploadTime = 0;
+        double DrawTime = 0;
+        double GpuUploadTime = -1;
+        double GpuDrawTime = -1;
+        SizeType DrawCallCount = 0;
+        SizeType InstanceCount = 0;
+        // The tessellated mode counts triangles on the GPU, the count
+        // arrives with the GPU times and is 0 until then
+        SizeType TriangleCount = 0;
+    };
+
+    EllipsoidRenderer(LenghtType a,
+                      LenghtType b,
+                      LenghtType c,
+                      SizeType vertexCount,
+                      SizeType surfaceCount);
+    ~EllipsoidRenderer();
+
+    EllipsoidRenderer(const EllipsoidRenderer&) = delete;
+    EllipsoidRenderer& operator=(const EllipsoidRenderer&) = delete;
+
+    // Both need the current OpenGL context
+    bool Initialize();
+    void CleanUp();
+
+    // Redoes the CPU stages invalidated since the last call, no GL calls
+    void Update(int width, int height);
+    void Render();
+
+    bool IsDirty() const { return DirtyFlags != CLEAN; }
+    // Counts of the mesh being drawn, chosen by LOD in the adaptive mode
+    LodLevel GetLevel() const { return Level; }
+
+    void SetRenderOptions(const RenderOptions& options);
+    // Called on a worker thread when an asynchronously built mesh is
+    // ready, the next Update picks it up
+    void SetMeshReadyCallback(std::function<void()> callback);
+    void SetScaleFactor(FloatType scaleFactor);
+    FloatType GetScaleFactor() const { return ScaleFactor; }
+    void SetAngle(RotateType rotateType, FloatType angle);
+    void SetAmbientCoeff(FloatType ambientCoeff);
+    void SetSpecularCoeff(FloatType specularCoeff);
+    void SetDiffuseCoeff(FloatType diffuseCoeff);
+    // Seconds since the animation start, the shader derives the colour
+    void SetTime(FloatType time);
+    void SetVertexCount(SizeType count);
+    void SetSurfaceCount(SizeType count);
+
+    const FrameStatistics& GetFrameStatistics() const { return Statistics; }
+    // Hits, misses, evictions and the memory of generated meshes
+    const MeshCache& GetMeshCache() const { return CachedMeshes; }
+    // Means over the last AVERAGE_WINDOW frames, counts included
+    FrameStatistics GetAverageStatistics() const;
+    bool HasGpuTimers() const { return HasTimerQueries; }
+    // Programs loaded from the cache and compiled by Initialize
+    const ShaderCache& GetShaderCache() const { return Shaders; }
+    // Duration of the last successful Initialize in milliseconds
+    double GetInitializationTime() const { return InitializationTime; }
+
+    static constexpr SizeType AVERAGE_WINDOW = 60;
+
+private:
+    static constexpr auto IMAGE_DEFAULT_SIZE = QSize(300, 300);
+    static const Vec3 VIEW_POINT;
+
+    static constexpr auto VERTEX_SHADER = ":/shaders/vertexShader.glsl";
+    static constexpr auto FRAGMENT_SHADER = ":/shaders/fragmentShader.glsl";
+    static constexpr auto TESSELLATION_VERTEX_SHADER =
+        ":/shaders/tessellationVertexShader.glsl";
+    static constexpr auto TESSELLATION_CONTROL_SHADER =
+        ":/shaders/tessellationControlShader.glsl";
+    static constexpr auto TESSELLATION_EVALUATION_SHADER =
+        ":/shaders/tessellationEvaluationShader.glsl";
+    static constexpr auto IMPOSTOR_VERTEX_SHADER =
+        ":/shaders/impostorVertexShader.glsl";
+    static constexpr auto IMPOSTOR_FRAGMENT_SHADER =
+        ":/shaders/impostorFragmentShader.glsl";
+    static constexpr auto POSITION = "position";
+    static constexpr auto COLOR = "color";
+    static constexpr auto TRANSFORM_MATRIX = "transformMatrix";
+    static constexpr auto ROTATE_MATRIX = "rotateMatrix";
+    static constexpr auto LIGHTING_BLOCK = "Lighting";
+    static constexpr auto TIME = "time";
+    static constexpr auto INSTANCE_OFFSET = "instanceOffset";
+    static constexpr auto INSTANCE_SCALE = "instanceScale";
+    static constexpr auto INSTANCE_ROTATION = "instanceRotation";
+    static constexpr auto INSTANCE_COLOR = "instanceColor";
+    static constexpr auto PROCEDURAL = "procedural";
+    static constexpr auto AXES = "axes";
+    static constexpr auto SEGMENT_COUNT = "segmentCount";
+    static constexpr auto RING_COUNT = "ringCount";
+    static constexpr auto RING_START = "ringStart";
+    static constexpr auto RING_STEP = "ringStep";
+    static constexpr auto HEIGHT_RANGE = "heightRange";
+    static constexpr auto PATCH_SEGMENTS = "patchSegments";
+    static constexpr auto PATCH_BANDS = "patchBands";
+    static constexpr auto VIEWPORT_SIZE = "viewportSize";
+    static constexpr auto PIXEL_ERROR = "pixelError";
+    static constexpr auto MAX_TESS_LEVEL = "maxTessLevel";
+    static constexpr GLuint LIGHTING_BINDING = 0;
+
+    // Mirrors the std140 Lighting block of the fragment shader
+    struct LightingBlock {
+        GLfloat AmbientCoeff;
+        GLfloat DiffuseCoeff;
+        GLfloat SpecularCoeff;
+        GLfloat Padding;
+    };
+    static_assert(sizeof(LightingBlock) == 16,
+                  "std140 block is padded to 16 bytes");
+
+    static constexpr auto DEPTH_SCALE = 0.25f;
+
+    // Coarse grid of the tessellated mode: patches around OZ, side bands
+    // between the caps, and a row of patches per cap
+    static constexpr SizeType PATCH_SEGMENT_COUNT = 8;
+    static constexpr SizeType PATCH_BAND_COUNT = 4;
+    static constexpr SizeType PATCH_VERTEX_COUNT = 4;
+    // Triangle strip of an impostor quad
+    static constexpr SizeType QUAD_VERTEX_COUNT = 4;
+
+    // Stages timed on the GPU
+    enum GpuStage { GPU_UPLOAD, GPU_DRAW, GPU_STAGE_COUNT };
+    // Frames whose queries may be in flight before a result is needed
+    static constexpr SizeType TIMER_FRAME_COUNT = 4;
+    using TimerQuerySet = std::array<GLuint, GPU_STAGE_COUNT>;
+
+    // Links the tessellated mode program when the context supports it
+    void CreateTessellationProgram();
+    // Shares instance attribute locations with the mesh program
+    void CreateImpostorProgram();
+    void BindLightingBlock(QOpenGLShaderProgram* program);
+    // Locations of the active program, they differ between programs
+    void ResolveUniforms();
+
+    // Makes the back arena the front one and returns it for writing
+    VertexArena& SwapArenas();
+    // Points the next upload to the mesh of Level, with the rotation
+    // baked into culled vertices when it's given. The mesh is found in
+    // the cache, requested from Builder or generated in place.
+    void PrepareMesh(const std::optional<Mat4x4>& rotateMatrix);
+    bool UseMeshCache() const { return Options.MeshCacheBytes > 0; }
+    // Meshes with a baked rotation bypass the cache
+    bool CanCacheMesh(const std::optional<Mat4x4>& rotateMatrix) const {
+        return UseMeshCache() && !rotateMatrix;
+    }
+    bool FindCachedMesh(const MeshKey& key);
+    void StoreMesh(const MeshKey& key, CachedMesh&& mesh);
+    void RequestMesh(const std::optional<Mat4x4>& rotateMatrix);
+    // Starts drawing the newest mesh published by Builder
+    void AdoptBuiltMesh();
+    float GetPixelsPerUnit() const;
+    // Both the indexed and the instanced modes draw an IndexedMesh
+    bool IsIndexed() const;
+    bool IsProcedural() const { return Options.Mode == RenderMode::PROCEDURAL; }
+    // False without tessellation support, INDEXED is drawn then
+    bool IsTessellated() const;
+    // False when the impostor program isn't linked, INSTANCED is drawn
+    bool IsImpostor() const;
+    // The instanced mode or the impostor one without its program
+    bool IsInstanced() const;
+    // Both draw the instance grid
+    bool UsesInstances() const;
+    // Other modes make their geometry in shaders
+    bool GeneratesMesh() const;
+    // Vertices the procedural draw emits for the current level
+    SizeType GetProceduralVertexCount() const;
+    static double GetElapsedTime(Clock::time_point start);
+
+    void UploadGeometry();
+    VertexLayout GetVertexLayout() const;
+    void SetupVertexAttributes();
+    void SetupInstanceAttributes();
+    static void ReserveBuffer(QOpenGLBuffer* buffer,
+                              SizeType& capacity,
+                              SizeType bytes);
+
+    Mat4x4 GenerateScaleMatrix(int width, int height) const;
+    Mat4x4 GenerateRotateMatrix(RotateType rotateType) const;
+
+    void CreateTimerQueries();
+    // Reads results of finished frames, never waits for the GPU
+    void ReadTimerQueries();
+    void BeginTimer(GpuStage stage);
+    void EndTimer();
+    void AddAverages();
+
+    void SetUniformMatrix(int location, const Mat4x4& matrix);
+    void SetProceduralUniforms();
+    void SetTessellationUniforms();
+    void SetImpostorUniforms();
+    void UploadLighting();
+
+    static Mat4x4 GenerateRotateMatrixByAngle(RotateType rotateType,
+                                              FloatType angle);
+    static Mat4x4 GenerateProjectionMatrix();
+    static Mat4x4 GenerateDepthProjectionMatrix();
+
+    ShaderCache Shaders;
+    double InitializationTime;
+    QOpenGLShaderProgram* MeshProgram;
+    // Null without tessellation support
+    QOpenGLShaderProgram* TessellationProgram;
+    QOpenGLShaderProgram* ImpostorProgram;
+    // One of the above, used by the current mode
+    QOpenGLShaderProgram* ShaderProgram;
+    QOpenGLBuffer* Buffer;
+    QOpenGLBuffer* IndexBuffer;
+    QOpenGLBuffer* InstanceBuffer;
+    QOpenGLVertexArrayObject* VertexArray;
+    // Has no arrays enabled, bound for procedural draws
+    QOpenGLVertexArrayObject* EmptyVertexArray;
+    SizeType VertexBufferCapacity;
+    SizeType IndexBufferCapacity;
+    SizeType InstanceBufferCapacity;
+    int PositionAttribute;
+    int ColorAttribute;
+    int InstanceOffsetAttribute;
+    int InstanceScaleAttribute;
+    int InstanceRotationAttribute;
+    int InstanceColorAttribute;
+    int RotateMatrixUniform;
+    int TransformMatrixUniform;
+    int TimeUniform;
+    int ProceduralUniform;
+    int AxesUniform;
+    int SegmentCountUniform;
+    int RingCountUniform;
+    int RingStartUniform;
+    int RingStepUniform;
+    int HeightRangeUniform;
+    int PatchSegmentsUniform;
+    int PatchBandsUniform;
+    int ViewportSizeUniform;
+    int PixelErrorUniform;
+    int MaxTessLevelUniform;
+    GLint MaxTessLevel;
+    GLuint LightingBuffer;
+    Ellipsoid EllipsoidLayer;
+    LenghtType BoundingRadius;
+    FloatType ScaleFactor;
+    FloatType AngleOX;
+    FloatType AngleOY;
+    FloatType AngleOZ;
+    FloatType AmbientCoeff;
+    FloatType SpecularCoeff;
+    FloatType DiffuseCoeff;
+    FloatType Time;
+    SizeType VertexCount;
+    SizeType SurfaceCount;
+    RenderOptions Options;
+    int Width;
+    int Height;
+    unsigned DirtyFlags;
+    unsigned UniformFlags;
+    bool GeometryChanged;
+    bool VertexLayoutChanged;
+    SizeType UploadedVertexCount;
+    Mat4x4 RotateMatrix;
+    Mat4x4 TransformMatrix;
+    LevelOfDetail Lod;
+    LodLevel Level;
+    // Generation writes into the back arena, the front one holds the
+    // vertices of the last upload
+    std::array<VertexArena, 2> Arenas;
+    SizeType FrontArena;
+    IndexedMesh Mesh;
+    // The drawn entry is always the most recent one, so it isn't evicted
+    MeshCache CachedMeshes;
+    // What the next upload reads: a front arena, Mesh, a cache entry or
+    // a buffer taken from Builder
+    const VertexArena* DrawArena;
+    const IndexedMesh* DrawMesh;
+    // Created on demand for the current options. Every result it
+    // publishes matches their mode.
+    std::unique_ptr<AsyncMeshBuilder> Builder;
+    std::function<void()> MeshReadyCallback;
+    // Grows with every prepared mesh. Builder results older than the
+    // drawn mesh, e.g. after a cache hit, are dropped.
+    SizeType MeshVersion;
+    SizeType DrawnVersion;
+    std::vector<PackedVertex> PackedVertices;
+    InstanceVector Instances;
+    FrameStatistics Statistics;
+    bool HasTimerQueries;
+    // Ring of query sets, TimerFrame is the oldest one and the next to use
+    std::array<TimerQuerySet, TIMER_FRAME_COUNT> TimerQueries;
+    std::array<bool, TIMER_FRAME_COUNT> TimerPending;
+    // GL_PRIMITIVES_GENERATED of timed tessellated draws
+    std::array<GLuint, TIMER_FRAME_COUNT> PrimitiveQueries;
+    std::array<bool, TIMER_FRAME_COUNT> PrimitivePending;
+    SizeType TessellatedTriangleCount;
+    SizeType TimerFrame;
+    bool TimingFrame;
+    RollingAverage GenerationAverage;
+    RollingAverage UploadAverage;
+    RollingAverage DrawAverage;
+    RollingAverage GpuUploadAverage;
+    RollingAverage GpuDrawAverage;
+    RollingAverage TriangleAverage;
+};
+
+#endif  // CG_LAB_ELLIPSOIDRENDERER_HPP_
@@ -0,0 +1,116 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_FRAMECAPTURE_HPP_
+#define CG_LAB_FRAMECAPTURE_HPP_
+
+#include <GeometryTypes.hpp>
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QOpenGLExtraFunctions>
+#include <QString>
+
+struct CaptureOptions {
+    enum class Format { PNG, RAW };
+
+    // Frames aren't captured when it's empty
+    QString Directory;
+    Format ImageFormat = Format::PNG;
+};
+
+// Writes frames of the bound framebuffer to numbered image files without
+// stalling the pipeline. Every frame is read into one of a ring of pixel
+// buffer objects and mapped READ_LATENCY frames later, when the GPU has
+// usually finished it. Writer threads flip, encode and save the pixels.
+class FrameCapture : protected QOpenGLExtraFunctions {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Counters {
+        SizeType Captured = 0;
+        SizeType Written = 0;
+        // Maps that had to wait for the GPU
+        SizeType GpuStalls = 0;
+        // Captures that waited for a free writer queue slot
+        SizeType WriterStalls = 0;
+    };
+
+    explicit FrameCapture(const CaptureOptions& options);
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // Need the current OpenGL context
+    bool Initialize();
+    void CleanUp();
+
+    // Starts reading a width x height frame of the bound framebuffer and
+    // hands frames read before to the writers
+    void Capture(int width, int height);
+    // Waits until every captured frame is written
+    void Finish();
+    // Waits for frames already handed to the writers only, doesn't need
+    // the OpenGL context
+    void WaitForWriters();
+
+    Counters GetCounters() const;
+    // Written frames per second since the first capture
+    double GetCaptureRate() const;
+
+private:
+    static constexpr SizeType RING_SIZE = 3;
+    static constexpr SizeType READ_LATENCY = RING_SIZE - 1;
+    // Mapped frames waiting for writers, bounds the memory
+    static constexpr SizeType MAX_QUEUED_FRAMES = 8;
+
+    struct PixelBuffer {
+        GLuint Buffer = 0;
+        GLsync Fence = nullptr;
+        SizeType Capacity = 0;
+        SizeType Index = 0;
+        int Width = 0;
+        int Height = 0;
+    };
+
+    struct Frame {
+        std::vector<unsigned char> Pixels;
+        SizeType Index = 0;
+        int Width = 0;
+        int Height = 0;
+    };
+
+    // Maps the buffer and queues its pixels, waits for the GPU if needed
+    void ReadBuffer(PixelBuffer& buffer);
+    void WriterLoop();
+    void WriteFrame(const Frame& frame) const;
+    QString GetFileName(const Frame& frame) const;
+
+    CaptureOptions Options;
+    std::array<PixelBuffer, RING_SIZE> Buffers;
+    SizeType NextIndex;
+    Clock::time_point StartTime;
+    Clock::time_point LastWriteTime;
+    Counters Statistics;
+
+    mutable std::mutex Mutex;
+    std::condition_variable QueueCondition;
+    std::condition_variable DoneCondition;
+    std::deque<Frame> Queue;
+    // Pixel vectors of written frames, reused to avoid allocations
+    std::vector<std::vector<unsigned char>> FreePixels;
+    SizeType BusyWriters;
+    bool Stopped;
+    std::vector<std::thread> Writers;
+};
+
+#endif  // CG_LAB_FRAMECAPTURE_HPP_
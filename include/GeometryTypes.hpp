@@ -0,0 +1,25 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_GEOMETRYTYPES_HPP_
+#define CG_LAB_GEOMETRYTYPES_HPP_
+
+#include <cstdint>
+
+#ifdef EIGEN3_INCLUDE_DIR
+#include <Eigen/Dense>
+#else
+#include <eigen3/Eigen/Dense>
+#endif
+
+using Vec3 = Eigen::Matrix<float, 1, 3>;
+using Vec4 = Eigen::Matrix<float, 1, 4>;
+using Mat4x4 = Eigen::Matrix<float, 4, 4>;
+using Map4x4 = Eigen::Map<Eigen::Matrix<float, 4, 4, Eigen::RowMajor>>;
+
+using SizeType = std::size_t;
+using LenghtType = float;
+
+#endif  // CG_LAB_GEOMETRYTYPES_HPP_
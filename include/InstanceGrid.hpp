@@ -0,0 +1,35 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_INSTANCEGRID_HPP_
+#define CG_LAB_INSTANCEGRID_HPP_
+
+#include <GeometryTypes.hpp>
+
+#include <vector>
+
+// Per-instance attributes of the instanced mode, uploaded as is
+struct EllipsoidInstance {
+    float Offset[3];
+    // Multiplies the axes of the shared mesh
+    float Scale[3];
+    // Unit quaternion x, y, z, w
+    float Rotation[4];
+    // Diffuse colour, alpha is its weight against the animated colour
+    float Color[4];
+};
+
+using InstanceVector = std::vector<EllipsoidInstance>;
+
+// Lays count ellipsoids out on a square grid that covers the area of one
+// ellipsoid of the given radius, so the scene fits the same view. Axes,
+// orientations and colours are random, but repeat for the same seed.
+// A single instance is the untinted ellipsoid as other modes draw it.
+void GenerateInstanceGrid(SizeType count,
+                          LenghtType radius,
+                          InstanceVector& instances,
+                          unsigned seed = 0);
+
+#endif  // CG_LAB_INSTANCEGRID_HPP_
@@ -0,0 +1,66 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_LEVELOFDETAIL_HPP_
+#define CG_LAB_LEVELOFDETAIL_HPP_
+
+#include <GeometryTypes.hpp>
+
+struct LodLevel {
+    SizeType VertexCount = 0;
+    SizeType SurfaceCount = 0;
+
+    bool operator==(const LodLevel& other) const {
+        return VertexCount == other.VertexCount &&
+               SurfaceCount == other.SurfaceCount;
+    }
+    bool operator!=(const LodLevel& other) const { return !(*this == other); }
+    bool operator<(const LodLevel& other) const {
+        return VertexCount < other.VertexCount ||
+               (VertexCount == other.VertexCount &&
+                SurfaceCount < other.SurfaceCount);
+    }
+};
+
+// Picks tessellation density from the projected size of the ellipsoid,
+// so the chord error of rings and of the profile stays under the target
+// pixel error. Counts are rounded up to 2^k or 3 * 2^k, which keeps the
+// number of distinct meshes small. The level is kept until the projected
+// size leaves the hysteresis band around the size it was chosen for.
+class LevelOfDetail {
+public:
+    static constexpr SizeType MIN_VERTEX_COUNT = 4;
+    static constexpr SizeType MAX_VERTEX_COUNT = 100;
+    static constexpr SizeType MIN_SURFACE_COUNT = 3;
+    static constexpr SizeType MAX_SURFACE_COUNT = 100;
+    static constexpr float DEFAULT_PIXEL_ERROR = 0.5f;
+    static constexpr float DEFAULT_HYSTERESIS = 0.25f;
+
+    LevelOfDetail(LenghtType a,
+                  LenghtType b,
+                  LenghtType c,
+                  float pixelError = DEFAULT_PIXEL_ERROR,
+                  float hysteresis = DEFAULT_HYSTERESIS);
+
+    // pixelsPerUnit is the on-screen length of one object space unit
+    LodLevel Select(float pixelsPerUnit);
+    // Level for the size without hysteresis
+    LodLevel Compute(float pixelsPerUnit) const;
+
+    void SetPixelError(float pixelError);
+    LodLevel GetLevel() const { return Level; }
+
+private:
+    static SizeType RoundUp(SizeType count, SizeType min, SizeType max);
+
+    LenghtType MaxRadius;
+    LenghtType MaxCurvature;
+    float PixelError;
+    float Hysteresis;
+    float SelectedScale;
+    LodLevel Level;
+};
+
+#endif  // CG_LAB_LEVELOFDETAIL_HPP_
@@ -0,0 +1,112 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_LRUCACHE_HPP_
+#define CG_LAB_LRUCACHE_HPP_
+
+#include <GeometryTypes.hpp>
+
+#include <functional>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+// Least recently used cache with a byte budget. Values stay at the same
+// address until they are evicted. The value of an evicted entry is kept
+// as a spare, so a caller can refill its storage instead of allocating.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+    struct Counters {
+        SizeType Hits = 0;
+        SizeType Misses = 0;
+        SizeType Evictions = 0;
+    };
+
+    explicit LruCache(SizeType capacity) : Capacity{capacity} {}
+
+    // Makes a found entry the most recent one, nullptr on a miss
+    Value* Find(const Key& key) {
+        const auto found = Index.find(key);
+        if (found == Index.end()) {
+            Statistics.Misses++;
+            return nullptr;
+        }
+        Statistics.Hits++;
+        Entries.splice(Entries.begin(), Entries, found->second);
+        return &found->second->EntryValue;
+    }
+
+    // Adds or replaces the most recent entry and evicts least recent
+    // ones over the budget. The new entry itself is never evicted.
+    Value& Insert(const Key& key, Value&& value, SizeType bytes) {
+        const auto found = Index.find(key);
+        if (found != Index.end()) {
+            ByteSize -= found->second->Bytes;
+            Entries.erase(found->second);
+            Index.erase(found);
+        }
+
+        Entries.push_front({key, std::move(value), bytes});
+        Index.emplace(key, Entries.begin());
+        ByteSize += bytes;
+        Evict(Capacity);
+        return Entries.front().EntryValue;
+    }
+
+    // Storage of the last evicted value or a new one
+    Value TakeSpare() {
+        Value spare = Spare ? std::move(*Spare) : Value();
+        Spare.reset();
+        return spare;
+    }
+
+    void SetCapacity(SizeType capacity) {
+        Capacity = capacity;
+        Evict(Capacity);
+    }
+
+    void Clear() {
+        Entries.clear();
+        Index.clear();
+        Spare.reset();
+        ByteSize = 0;
+    }
+
+    SizeType GetCapacity() const { return Capacity; }
+    SizeType GetByteSize() const { return ByteSize; }
+    SizeType GetCount() const { return Entries.size(); }
+    const Counters& GetCounters() const { return Statistics; }
+
+private:
+    struct Entry {
+        Key EntryKey;
+        Value EntryValue;
+        SizeType Bytes;
+    };
+    using EntryList = std::list<Entry>;
+
+    void Evict(SizeType capacity) {
+        while (ByteSize > capacity && Entries.size() > 1) {
+            auto& last = Entries.back();
+            ByteSize -= last.Bytes;
+            Index.erase(last.EntryKey);
+            Spare = std::move(last.EntryValue);
+            Entries.pop_back();
+            Statistics.Evictions++;
+        }
+    }
+
+    SizeType Capacity;
+    SizeType ByteSize = 0;
+    // Most recent entries first
+    EntryList Entries;
+    std::unordered_map<Key, typename EntryList::iterator, Hash> Index;
+    std::optional<Value> Spare;
+    Counters Statistics;
+};
+
+#endif  // CG_LAB_LRUCACHE_HPP_
@@ -0,0 +1,47 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_MESHCACHE_HPP_
+#define CG_LAB_MESHCACHE_HPP_
+
+#include <Ellipsoid.hpp>
+#include <LruCache.hpp>
+
+// Everything an object space mesh depends on. Culled meshes have the
+// rotation baked in, nearly every frame of a drag has its own one, so
+// they aren't cached.
+struct MeshKey {
+    LenghtType A;
+    LenghtType B;
+    LenghtType C;
+    SizeType VertexCount;
+    SizeType SurfaceCount;
+    bool Indexed;
+
+    MeshKey(const Ellipsoid& ellipsoid,
+            SizeType vertexCount,
+            SizeType surfaceCount,
+            bool indexed);
+
+    bool operator==(const MeshKey& other) const;
+};
+
+struct MeshKeyHash {
+    SizeType operator()(const MeshKey& key) const;
+};
+
+// Only one of the members is filled, as the key tells
+struct CachedMesh {
+    VertexArena Arena;
+    IndexedMesh Mesh;
+
+    SizeType GetByteSize() const {
+        return Arena.GetByteSize() + Mesh.GetByteSize();
+    }
+};
+
+using MeshCache = LruCache<MeshKey, CachedMesh, MeshKeyHash>;
+
+#endif  // CG_LAB_MESHCACHE_HPP_
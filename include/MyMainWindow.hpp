@@ -6,6 +6,9 @@
 #ifndef CG_LAB_MYMAINWINDOW_HPP_
 #define CG_LAB_MYMAINWINDOW_HPP_
 
+#include <FrameCapture.hpp>
+#include <RenderOptions.hpp>
+
 #include <QMainWindow>
 
 #include <array>
@@ -17,14 +20,22 @@ class MyMainWindow : public QMainWindow {
 
 public:
     explicit MyMainWindow(QWidget* parent = nullptr);
+    explicit MyMainWindow(const RenderOptions& options,
+                          QWidget* parent = nullptr);
     ~MyMainWindow() = default;
 
+    void StartCapture(const CaptureOptions& options);
+
     static constexpr auto VARIANT_DESCRIPTION =
         "Computer grapics lab 6\n"
         "Variant 20: ellipsoid layer with сolor\n"
         "changing by sinusoidal law\n"
         "Made by Roman Khomenko (8O-308)";
 
+protected:
+    // Finishes the capture while the widget and its context exist
+    void closeEvent(QCloseEvent* event) override;
+
 private:
     QWidget* CreateCentralWidget();
 
@@ -6,24 +6,23 @@
 #ifndef CG_LAB_MYOPENGLWIDGET_HPP_
 #define CG_LAB_MYOPENGLWIDGET_HPP_
 
-#include <Ellipsoid.hpp>
+#include <EllipsoidRenderer.hpp>
+#include <FrameCapture.hpp>
 
-#include <array>
+#include <memory>
 
-#include <QOpenGLFunctions>
+#include <QElapsedTimer>
 #include <QOpenGLWidget>
 
-class QOpenGLBuffer;
-class QOpenGLVertexArrayObject;
-class QOpenGLShaderProgram;
-
+class QLabel;
 class QTimer;
 
-class MyOpenGLWidget : public QOpenGLWidget, protected QOpenGLFunctions {
+class MyOpenGLWidget : public QOpenGLWidget {
     Q_OBJECT
 
 public:
     using FloatType = float;
+    using FrameStatistics = EllipsoidRenderer::FrameStatistics;
 
     explicit MyOpenGLWidget(QWidget* parent = nullptr);
     explicit MyOpenGLWidget(LenghtType a,
@@ -34,6 +33,18 @@ public:
                             QWidget* parent = nullptr);
     ~MyOpenGLWidget();
 
+    void SetRenderOptions(const RenderOptions& options);
+    // Writes every painted frame to options.Directory
+    void StartCapture(const CaptureOptions& options);
+    // Writes the pending frames and prints the capture summary
+    void StopCapture();
+    // Stage times and draw calls of the last paintGL
+    const FrameStatistics& GetFrameStatistics() const;
+    // Rolling averages shown by the HUD
+    FrameStatistics GetAverageStatistics() const;
+
+    // Slots only record changes and schedule a repaint. Qt merges pending
+    // update() requests, so there is at most one rebuild per frame.
 public slots:
     void ScaleUpSlot();
     void ScaleDownSlot();
@@ -49,9 +60,11 @@ public slots:
     void VertexCountChangedSlot(int count);
     void SurfaceCountChangedSlot(int count);
 
+    // Shows or hides the performance overlay
+    void ToggleHudSlot();
+
 protected:
     void initializeGL() override;
-    void resizeGL(int width, int height) override;
     void paintGL() override;
 
 private slots:
@@ -59,63 +72,18 @@ private slots:
     void OnTimeoutSlot();
 
 private:
-    enum RotateType { OX, OY, OZ };
+    void UpdateHud();
 
     static constexpr auto WIDGET_DEFAULT_SIZE = QSize(350, 350);
-    static constexpr auto IMAGE_DEFAULT_SIZE = QSize(300, 300);
-    static const Vec3 VIEW_POINT;
-    static const float PI;
-
-    static constexpr auto VERTEX_SHADER = ":/shaders/vertexShader.glsl";
-    static constexpr auto FRAGMENT_SHADER = ":/shaders/fragmentShader.glsl";
-    static constexpr auto POSITION = "position";
-    static constexpr auto COLOR = "color";
-    static constexpr auto TRANSFORM_MATRIX = "transformMatrix";
-    static constexpr auto AMBIENT_COEFF = "ambientCoeff";
-    static constexpr auto DIFFUSE_COEFF = "diffuseCoeff";
-    static constexpr auto SPECULAR_COEFF = "specularCoeff";
-    static constexpr auto DIFFUSE_COLOR = "diffuseColor";
-
     static constexpr auto SCALE_FACTOR_PER_ONCE = 1.15f;
 
-    static SizeType GetVertexCount(const LayerVector& layers);
-
-    void UpdateOnChange(int width, int height);
-    void OnWidgetUpdate();
-
-    Mat4x4 GenerateScaleMatrix(int width, int height) const;
-    Mat4x4 GenerateRotateMatrix(RotateType rotateType) const;
-
-    void SetUniformMatrix(const Mat4x4& transformMatrix);
-    void SetUniformValue(const char* name, float value);
-
-    static Mat4x4 GenerateRotateMatrixByAngle(RotateType rotateType,
-                                              FloatType angle);
-    static Mat4x4 GenerateProjectionMatrix();
-
-    QOpenGLShaderProgram* ShaderProgram;
-    QOpenGLBuffer* Buffer;
-    QOpenGLVertexArrayObject* VertexArray;
-    Ellipsoid EllipsoidLayer;
-    FloatType ScaleFactor;
-    FloatType AngleOX;
-    FloatType AngleOY;
-    FloatType AngleOZ;
-    FloatType AmbientCoeff;
-    FloatType SpecularCoeff;
-    FloatType DiffuseCoeff;
-    FloatType A;
-    FloatType B;
-    FloatType C;
-    SizeType VertexCount;
-    SizeType SurfaceCount;
-    LayerVector Layers;
+    EllipsoidRenderer Renderer;
+    std::unique_ptr<FrameCapture> Capture;
     QTimer* Timer;
-    FloatType Teta;
-    FloatType Phi;
-    FloatType Red;
-    FloatType Green;
-    FloatType Blue;
+    QLabel* Hud;
+    QElapsedTimer AnimationClock;
+    // Runs from construction to the first painted frame
+    QElapsedTimer StartupClock;
 };
 
 #endif  // CG_LAB_MYOPENGLWIDGET_HPP_
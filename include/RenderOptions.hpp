@@ -0,0 +1,54 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_RENDEROPTIONS_HPP_
+#define CG_LAB_RENDEROPTIONS_HPP_
+
+#include <cstddef>
+
+enum class RenderMode {
+    // Rotation and back-face culling are baked into vertices on the CPU
+    CPU_TRANSFORM,
+    // Mesh is built once in object space and rotated in the vertex shader
+    GPU_TRANSFORM,
+    // Same as GPU_TRANSFORM with shared vertices and an element buffer
+    INDEXED,
+    // INDEXED mesh drawn once per instance with its own axes, rotation
+    // and colour in one call
+    INSTANCED,
+    // The vertex shader derives the INDEXED mesh from gl_VertexID and
+    // the tessellation params, nothing is generated or uploaded
+    PROCEDURAL,
+    // A coarse patch grid refined by tessellation shaders, levels follow
+    // the on-screen size instead of the sliders. Needs GL 4.0, INDEXED
+    // is drawn without it.
+    TESSELLATED,
+    // Every instance of the INSTANCED scene is a screen aligned quad, its
+    // fragments intersect view rays with the exact surface
+    IMPOSTOR
+};
+
+struct RenderOptions {
+    RenderMode Mode = RenderMode::CPU_TRANSFORM;
+    // Upload 16 bytes PackedVertex instead of 32 bytes Vertex
+    bool PackedVertices = false;
+    // Pick vertex and surface counts from the on-screen size instead of
+    // the sliders
+    bool AdaptiveLod = false;
+    // Allowed distance between the mesh and the surface in pixels, used
+    // by the adaptive LOD and the tessellated mode
+    float LodPixelError = 0.5f;
+    // Ellipsoids of the instanced and impostor modes
+    std::size_t InstanceCount = 1000;
+    // Generate meshes on a background thread and draw the previous one
+    // until the new one is ready
+    bool AsyncGeneration = false;
+    // Budget of the LRU cache of generated meshes in bytes, 0 disables it
+    std::size_t MeshCacheBytes = 64 << 20;
+    // Load linked shader programs from the on-disk cache when possible
+    bool CacheShaders = true;
+};
+
+#endif  // CG_LAB_RENDEROPTIONS_HPP_
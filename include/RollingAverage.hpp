@@ -0,0 +1,44 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_ROLLINGAVERAGE_HPP_
+#define CG_LAB_ROLLINGAVERAGE_HPP_
+
+#include <GeometryTypes.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+// Mean of the last window samples, adding one doesn't allocate
+class RollingAverage {
+public:
+    explicit RollingAverage(SizeType window) : Samples(window, 0) {}
+
+    void Add(double sample) {
+        Samples[Next] = sample;
+        Next = (Next + 1) % Samples.size();
+        Count = std::min(Count + 1, Samples.size());
+    }
+
+    // Zero until the first sample
+    double Get() const {
+        if (Count == 0) {
+            return 0;
+        }
+        return std::accumulate(Samples.begin(), Samples.begin() + Count,
+                               0.0) /
+               Count;
+    }
+
+    SizeType GetCount() const { return Count; }
+
+private:
+    std::vector<double> Samples;
+    SizeType Next = 0;
+    SizeType Count = 0;
+};
+
+#endif  // CG_LAB_ROLLINGAVERAGE_HPP_
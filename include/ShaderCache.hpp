@@ -0,0 +1,67 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_SHADERCACHE_HPP_
+#define CG_LAB_SHADERCACHE_HPP_
+
+#include <GeometryTypes.hpp>
+
+#include <utility>
+#include <vector>
+
+#include <QByteArray>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShader>
+#include <QString>
+
+class QOpenGLShaderProgram;
+
+// Keeps linked program binaries on disk. An entry is keyed by a hash of
+// the driver strings, the shader sources and the attribute locations,
+// so an edited shader or an updated driver compiles again. Binaries the
+// driver rejects are removed and the program is compiled instead.
+class ShaderCache : protected QOpenGLExtraFunctions {
+public:
+    struct ShaderSource {
+        QOpenGLShader::ShaderType Type;
+        QString Path;
+    };
+    using ShaderList = std::vector<ShaderSource>;
+    using AttributeList = std::vector<std::pair<const char*, int>>;
+
+    struct Counters {
+        SizeType Loaded = 0;
+        SizeType Compiled = 0;
+        // Entries the driver didn't accept, usually stale ones
+        SizeType Rejected = 0;
+    };
+
+    explicit ShaderCache(const QString& directory = GetDefaultDirectory());
+
+    // Needs the current OpenGL context. Programs are always compiled
+    // when disabled or when the driver can't return binaries.
+    void Initialize(bool enabled);
+    bool IsEnabled() const { return Enabled; }
+
+    // Binds attributes, then loads or compiles and links the program
+    bool Link(QOpenGLShaderProgram& program,
+              const ShaderList& shaders,
+              const AttributeList& attributes = {});
+
+    const Counters& GetCounters() const { return Statistics; }
+
+    static QString GetDefaultDirectory();
+
+private:
+    bool LoadBinary(QOpenGLShaderProgram& program, const QString& path);
+    void StoreBinary(QOpenGLShaderProgram& program, const QString& path);
+
+    QString Directory;
+    bool Enabled;
+    QByteArray DriverId;
+    Counters Statistics;
+};
+
+#endif  // CG_LAB_SHADERCACHE_HPP_
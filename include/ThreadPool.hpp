@@ -0,0 +1,123 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_THREADPOOL_HPP_
+#define CG_LAB_THREADPOOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Long-lived pool of worker threads. Every worker owns a bounded task
+// queue; idle workers steal from the tail of the other queues. When all
+// queues are full the task runs on the submitting thread instead.
+// ParallelFor runs an index range without any heap allocation.
+class ThreadPool {
+public:
+    using SizeType = std::size_t;
+    using Task = std::function<void()>;
+
+    static constexpr SizeType DEFAULT_QUEUE_CAPACITY = 256;
+
+    explicit ThreadPool(SizeType threadCount = GetDefaultThreadCount(),
+                        SizeType queueCapacity = DEFAULT_QUEUE_CAPACITY);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <typename Func>
+    auto Submit(Func&& func) -> std::future<std::invoke_result_t<Func>>;
+
+    // Calls func(i) for i in [0, count) on the workers and the calling
+    // thread, returns when all calls are done
+    template <typename Func>
+    void ParallelFor(SizeType count, Func&& func);
+
+    SizeType GetThreadCount() const { return Workers.size(); }
+
+    static SizeType GetDefaultThreadCount();
+    // Process-wide pool of GetDefaultThreadCount workers, created on the
+    // first call and shared by everything that isn't given its own pool
+    static std::shared_ptr<ThreadPool> GetDefault();
+
+private:
+    using BatchFunction = void (*)(void* context, SizeType index);
+
+    struct WorkQueue {
+        std::mutex Mutex;
+        std::deque<Task> Tasks;
+    };
+
+    bool Push(Task& task);
+    bool Pop(SizeType index, Task& task);
+    void WorkerLoop(SizeType index);
+
+    void RunBatch(SizeType count, BatchFunction function, void* context);
+    bool HasBatchWork() const;
+    // Returns false when there was no batch to join
+    bool JoinBatch(std::unique_lock<std::mutex>& lock);
+
+    std::vector<std::unique_ptr<WorkQueue>> Queues;
+    std::vector<std::thread> Workers;
+    SizeType QueueCapacity;
+    std::atomic<SizeType> NextQueue;
+    std::atomic<SizeType> PendingCount;
+    std::mutex SleepMutex;
+    std::condition_variable SleepCondition;
+    bool Stopped;
+
+    // State of the running ParallelFor, guarded by SleepMutex except
+    // for the atomic counters
+    std::mutex BatchMutex;
+    std::condition_variable BatchCondition;
+    BatchFunction CurrentBatch;
+    void* BatchContext;
+    SizeType BatchCount;
+    SizeType BatchUsers;
+    std::atomic<SizeType> BatchNext;
+    std::atomic<SizeType> BatchDone;
+};
+
+template <typename Func>
+auto ThreadPool::Submit(Func&& func)
+    -> std::future<std::invoke_result_t<Func>> {
+    using ResultType = std::invoke_result_t<Func>;
+
+    auto packagedTask = std::make_shared<std::packaged_task<ResultType()>>(
+        std::forward<Func>(func));
+    auto future = packagedTask->get_future();
+
+    Task task = [packagedTask]() { (*packagedTask)(); };
+    if (!Push(task)) {
+        // All queues are full: run on the caller thread
+        task();
+    }
+    return future;
+}
+
+template <typename Func>
+void ThreadPool::ParallelFor(SizeType count, Func&& func) {
+    using FuncType = std::remove_reference_t<Func>;
+
+    // Plain function pointer and context instead of std::function,
+    // so big lambdas don't allocate either
+    RunBatch(
+        count,
+        [](void* context, SizeType index) {
+            (*static_cast<FuncType*>(context))(index);
+        },
+        const_cast<void*>(static_cast<const void*>(&func)));
+}
+
+#endif  // CG_LAB_THREADPOOL_HPP_
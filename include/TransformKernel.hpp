@@ -0,0 +1,62 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#ifndef CG_LAB_TRANSFORMKERNEL_HPP_
+#define CG_LAB_TRANSFORMKERNEL_HPP_
+
+#include <GeometryTypes.hpp>
+
+#include <vector>
+
+// Positions stored as structure of arrays, so that a batch of them fits
+// into one SIMD register per coordinate
+class PositionArray {
+public:
+    using FloatType = float;
+    using FloatVector = std::vector<FloatType>;
+
+    PositionArray() = default;
+    explicit PositionArray(SizeType size) { Resize(size); }
+
+    void Resize(SizeType size);
+    SizeType GetSize() const { return X.size(); }
+
+    void Set(SizeType index, FloatType x, FloatType y, FloatType z) {
+        X[index] = x;
+        Y[index] = y;
+        Z[index] = z;
+        W[index] = 1;
+    }
+    Vec4 Get(SizeType index) const {
+        return Vec4(X[index], Y[index], Z[index], W[index]);
+    }
+
+    FloatVector X;
+    FloatVector Y;
+    FloatVector Z;
+    FloatVector W;
+};
+
+// Batch `position * matrix` product for whole position arrays. Uses AVX
+// or SSE when the compiler targets them and plain loops otherwise.
+class TransformKernel {
+public:
+    static void Transform(const PositionArray& input,
+                          const Mat4x4& matrix,
+                          PositionArray& output);
+    static void TransformScalar(const PositionArray& input,
+                                const Mat4x4& matrix,
+                                PositionArray& output);
+
+    static const char* GetInstructionSet();
+
+private:
+    static void TransformScalar(const PositionArray& input,
+                                const Mat4x4& matrix,
+                                SizeType begin,
+                                PositionArray& output);
+};
+
+#endif  // CG_LAB_TRANSFORMKERNEL_HPP_
@@ -12,6 +12,30 @@
 #include <eigen3/Eigen/Dense>
 #endif
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Description of one vertex attribute inside a vertex buffer
+struct VertexAttribute {
+    enum class Semantic { POSITION, NORMAL };
+    enum class ComponentType { FLOAT, INT_2_10_10_10_REV };
+
+    Semantic AttributeSemantic;
+    ComponentType Type;
+    std::int32_t TupleSize;
+    std::int32_t Offset;
+    bool Normalized;
+};
+
+struct VertexLayout {
+    std::vector<VertexAttribute> Attributes;
+    std::int32_t Stride;
+};
+
 class Vertex {
 public:
     using FloatType = float;
@@ -32,6 +56,8 @@ public:
 
     Vertex(Vertex&& v) = default;
     Vertex(const Vertex& v) = default;
+    Vertex& operator=(Vertex&& v) = default;
+    Vertex& operator=(const Vertex& v) = default;
 
     void SetColor(const Vec4& color) noexcept { ToArray(color, Color); }
 
@@ -56,6 +82,16 @@ public:
 
     static constexpr IntType GetStride() noexcept { return sizeof(Vertex); }
 
+    static VertexLayout GetLayout() {
+        using Semantic = VertexAttribute::Semantic;
+        using Type = VertexAttribute::ComponentType;
+        return {{{Semantic::POSITION, Type::FLOAT, GetPositionTupleSize(),
+                  GetPositionOffset(), false},
+                 {Semantic::NORMAL, Type::FLOAT, GetColorTupleSize(),
+                  GetColorOffset(), false}},
+                GetStride()};
+    }
+
 private:
     static const IntType POSITION_TUPLE_SIZE = 3;
     static const IntType COLOR_TUPLE_SIZE = 4;
@@ -72,4 +108,51 @@ private:
     FloatType Color[4];
 };
 
+// Compact 16 bytes vertex: position and normal packed into signed
+// normalized 10-bit components
+class PackedVertex {
+public:
+    using FloatType = Vertex::FloatType;
+    using IntType = Vertex::IntType;
+    using PackedType = std::uint32_t;
+
+    PackedVertex() = default;
+    PackedVertex(const Vertex& vertex) : Normal{PackNormal(vertex.GetColor())} {
+        const auto position = vertex.GetPosition();
+        std::memcpy(Position, position.data(), sizeof(Position));
+    }
+
+    static VertexLayout GetLayout() {
+        using Semantic = VertexAttribute::Semantic;
+        using Type = VertexAttribute::ComponentType;
+        return {{{Semantic::POSITION, Type::FLOAT, POSITION_TUPLE_SIZE,
+                  offsetof(PackedVertex, Position), false},
+                 {Semantic::NORMAL, Type::INT_2_10_10_10_REV, NORMAL_TUPLE_SIZE,
+                  offsetof(PackedVertex, Normal), true}},
+                sizeof(PackedVertex)};
+    }
+
+private:
+    static const IntType POSITION_TUPLE_SIZE = 3;
+    static const IntType NORMAL_TUPLE_SIZE = 4;
+
+    static PackedType PackNormal(const Vertex::Vec4& normal) {
+        auto pack = [](FloatType value, FloatType maxValue, IntType bits) {
+            const auto clamped = std::max(-1.0f, std::min(value, 1.0f));
+            const auto mask = (1U << bits) - 1;
+            return static_cast<PackedType>(
+                       static_cast<IntType>(std::round(clamped * maxValue))) &
+                   mask;
+        };
+
+        // w always equals 1, so the normal survives multiplying by
+        // the rotation matrix in the vertex shader like the float one
+        return pack(normal[0], 511, 10) | pack(normal[1], 511, 10) << 10 |
+               pack(normal[2], 511, 10) << 20 | pack(1, 1, 2) << 30;
+    }
+
+    FloatType Position[POSITION_TUPLE_SIZE];
+    PackedType Normal;
+};
+
 #endif  // CG_LAB_VERTEX_HPP_
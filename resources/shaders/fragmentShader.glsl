@@ -7,21 +7,35 @@
 
 varying highp vec4 normal;
 varying highp vec4 point;
-
-uniform highp float ambientCoeff;
-uniform highp float diffuseCoeff;
-uniform highp float specularCoeff;
-uniform highp vec4 diffuseColor;
+// Instance colour, alpha is its weight against the animated colour
+varying highp vec4 tint;
+
+layout(std140) uniform Lighting {
+    highp float ambientCoeff;
+    highp float diffuseCoeff;
+    highp float specularCoeff;
+};
+uniform highp float time;
 uniform highp vec3 light = vec3(0, 0, 1);
 uniform highp vec3 toObserverVec = vec3(0, 0, 1);
 
 const highp vec3 color = vec3(0.0f, 0.0f, 1.0f);
 const highp float shineCoeff = 1.0f;
+const highp float PI = 3.14159265f;
+// Seconds to raise one channel of the diffuse colour to its maximum
+const highp float channelTime = 5.0f;
+
+// Channels rise one after another, then the cycle starts from black
+vec3 getDiffuseColor() {
+    float phase = mod(time, 3 * channelTime) / channelTime;
+    vec3 channels = clamp(vec3(phase, phase - 1, phase - 2), 0.0f, 1.0f);
+    return sin(channels * PI / 2);
+}
 
 void main() {
     vec3 point3 = point.xyz;
     vec3 normal3 = normal.xyz;
-    vec3 diffuseColor3 = diffuseColor.xyz;
+    vec3 diffuseColor3 = mix(getDiffuseColor(), tint.rgb, tint.a);
 
     vec3 ambientI = ambientCoeff * color;
     vec3 fromPointToLightVec = light - point3;
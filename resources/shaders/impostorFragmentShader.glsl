@@ -0,0 +1,121 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#version 330
+
+in highp vec2 rayOrigin;
+flat in highp vec3 offset;
+flat in highp vec3 scale;
+flat in highp vec4 rotation;
+// Instance colour, alpha is its weight against the animated colour
+flat in highp vec4 tint;
+
+layout(std140) uniform Lighting {
+    highp float ambientCoeff;
+    highp float diffuseCoeff;
+    highp float specularCoeff;
+};
+uniform highp float time;
+uniform highp vec3 light = vec3(0, 0, 1);
+uniform highp vec3 toObserverVec = vec3(0, 0, 1);
+uniform highp mat4x4 transformMatrix;
+uniform highp mat4x4 rotateMatrix;
+uniform highp vec3 axes;
+uniform highp vec2 heightRange;
+
+out highp vec4 fragColor;
+
+const highp vec3 color = vec3(0.0f, 0.0f, 1.0f);
+const highp float shineCoeff = 1.0f;
+const highp float PI = 3.14159265f;
+// Seconds to raise one channel of the diffuse colour to its maximum
+const highp float channelTime = 5.0f;
+
+// Channels rise one after another, then the cycle starts from black
+vec3 getDiffuseColor() {
+    float phase = mod(time, 3 * channelTime) / channelTime;
+    vec3 channels = clamp(vec3(phase, phase - 1, phase - 2), 0.0f, 1.0f);
+    return sin(channels * PI / 2);
+}
+
+// Rotates v by the unit quaternion q
+vec3 rotate(vec4 q, vec3 v) {
+    return v + 2 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+// World to object space of the instance, w is 1 for points and 0 for
+// directions. The inverse of the rotation matrix is its transpose.
+vec3 toObject(vec3 v, float w) {
+    vec3 local = (rotateMatrix * vec4(v, w)).xyz - offset * w;
+    return rotate(vec4(-rotation.xyz, rotation.w), local) / scale;
+}
+
+void main() {
+    // The observer looks from +OZ. Linear maps keep ray parameters, so
+    // the parameter found in object space holds in the world too.
+    vec3 origin = toObject(vec3(rayOrigin, 0), 1);
+    vec3 direction = toObject(vec3(0, 0, -1), 0);
+
+    // x^2 / a^2 + y^2 / b^2 + z^2 = c^2, the surface Layer builds rings of
+    vec3 weights = vec3(1 / (axes.xy * axes.xy), 1);
+    float qa = dot(direction * weights, direction);
+    float qb = 2 * dot(origin * weights, direction);
+    float qc = dot(origin * weights, origin) - axes.z * axes.z;
+    float discriminant = qb * qb - 4 * qa * qc;
+    if (discriminant < 0) {
+        discard;
+    }
+    float root = sqrt(discriminant);
+    float enter = (-qb - root) / (2 * qa);
+    float leave = (-qb + root) / (2 * qa);
+
+    // Flat caps cut the surface at the first and the last ring heights
+    bool cap = false;
+    if (abs(direction.z) > 1e-6) {
+        float first = (heightRange.x - origin.z) / direction.z;
+        float last = (heightRange.y - origin.z) / direction.z;
+        if (min(first, last) > enter) {
+            enter = min(first, last);
+            cap = true;
+        }
+        leave = min(leave, max(first, last));
+    } else if (origin.z < heightRange.x || origin.z > heightRange.y) {
+        discard;
+    }
+    if (enter > leave) {
+        discard;
+    }
+
+    vec3 hit = origin + enter * direction;
+    vec3 objectNormal = hit * weights;
+    if (cap) {
+        objectNormal = vec3(0, 0, direction.z > 0 ? -1 : 1);
+    }
+    // Normals scale inversely, as in the vertex shader of meshes
+    vec3 localNormal = normalize(rotate(rotation, objectNormal / scale));
+
+    vec3 point3 = vec3(rayOrigin, 0) + enter * vec3(0, 0, -1);
+    vec3 normal3 = (vec4(localNormal, 0) * rotateMatrix).xyz;
+    vec4 clip = vec4(point3, 1) * transformMatrix;
+    gl_FragDepth = 0.5 * clip.z / clip.w + 0.5;
+
+    // Same lighting as fragmentShader.glsl
+    vec3 diffuseColor3 = mix(getDiffuseColor(), tint.rgb, tint.a);
+
+    vec3 ambientI = ambientCoeff * color;
+    vec3 fromPointToLightVec = light - point3;
+    vec3 diffuseI = diffuseCoeff *
+                    max(dot(fromPointToLightVec, normal3), 1.f) *
+                    diffuseColor3;
+
+    vec3 reflectedLightVec = 2 * dot(normal3, fromPointToLightVec) * normal3 -
+                             fromPointToLightVec;
+    vec3 specularI = specularCoeff *
+                     pow(dot(reflectedLightVec, toObserverVec), shineCoeff) *
+                     color;
+
+    vec3 I = ambientI + diffuseI + specularI;
+    fragColor = vec4(I.xyz, 1);
+}
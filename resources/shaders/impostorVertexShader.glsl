@@ -0,0 +1,60 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#version 330
+
+// Locations are bound to the ones of the mesh program, so the instance
+// arrays of its vertex array are shared
+in highp vec3 instanceOffset;
+in highp vec3 instanceScale;
+in highp vec4 instanceRotation;
+in highp vec4 instanceColor;
+
+uniform highp mat4x4 transformMatrix;
+uniform highp mat4x4 rotateMatrix;
+uniform highp vec3 axes;
+uniform highp vec2 heightRange;
+
+// World position of the quad point, its ray goes along -OZ
+out highp vec2 rayOrigin;
+flat out highp vec3 offset;
+flat out highp vec3 scale;
+flat out highp vec4 rotation;
+flat out highp vec4 tint;
+
+// Triangle strip, counter-clockwise on screen
+const vec2 QUAD_CORNERS[4] = vec2[4](vec2(-1, -1), vec2(1, -1),
+                                     vec2(-1, 1), vec2(1, 1));
+
+// Rotates v by the unit quaternion q
+vec3 rotate(vec4 q, vec3 v) {
+    return v + 2 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+// World direction and length of an object space axis
+vec3 worldAxis(vec3 axis) {
+    vec3 local = rotate(instanceRotation, axis * instanceScale);
+    return (vec4(local, 0) * rotateMatrix).xyz;
+}
+
+void main() {
+    // Rings are r(h) * (a cos, b sin) with r(h) <= c
+    float maxHeight = max(abs(heightRange.x), abs(heightRange.y));
+    vec3 halfBox = vec3(axes.xy * axes.z, maxHeight);
+
+    // Screen aligned bounds of the rotated box
+    vec3 extent = abs(worldAxis(vec3(1, 0, 0))) * halfBox.x +
+                  abs(worldAxis(vec3(0, 1, 0))) * halfBox.y +
+                  abs(worldAxis(vec3(0, 0, 1))) * halfBox.z;
+    vec3 center = (vec4(instanceOffset, 1) * rotateMatrix).xyz;
+    vec2 corner = center.xy + QUAD_CORNERS[gl_VertexID] * extent.xy;
+
+    rayOrigin = corner;
+    offset = instanceOffset;
+    scale = instanceScale;
+    rotation = instanceRotation;
+    tint = instanceColor;
+    gl_Position = vec4(corner, center.z, 1) * transformMatrix;
+}
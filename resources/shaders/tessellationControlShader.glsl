@@ -0,0 +1,66 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#version 400
+
+layout(vertices = 4) out;
+
+uniform highp mat4x4 transformMatrix;
+uniform highp mat4x4 rotateMatrix;
+uniform highp vec3 axes;
+uniform highp vec2 heightRange;
+uniform int patchSegments;
+uniform int patchBands;
+uniform highp vec2 viewportSize;
+uniform highp float pixelError;
+uniform highp float maxTessLevel;
+
+in vec2 gridCoord[];
+out vec2 patchCoord[];
+
+const highp float PI = 3.14159265f;
+
+// Same surface as the tessellation evaluation shader
+vec3 gridPoint(vec2 grid) {
+    float phi = 2 * PI * mod(grid.x, float(patchSegments)) / patchSegments;
+    float band = clamp(grid.y - 1, 0, patchBands);
+    float h = mix(heightRange.x, heightRange.y, band / patchBands);
+    float radius = sqrt((axes.z * axes.z - h * h) / axes.z * axes.z);
+    vec2 rim = radius * axes.xy * vec2(cos(phi), sin(phi));
+    // Caps shrink the rim from 1 at the side bands to 0 at the centers
+    float capScale = clamp(min(grid.y, patchBands + 2 - grid.y), 0, 1);
+    return vec3(rim * capScale, h);
+}
+
+vec2 toPixels(vec3 p) {
+    vec4 clip = vec4(p, 1) * rotateMatrix * transformMatrix;
+    return clip.xy / clip.w * viewportSize / 2;
+}
+
+// A chord k times shorter misses the curve about k^2 times less, so the
+// on-screen miss of the whole edge gives its segment count. Neighbours
+// get the same level for the shared edge, so there are no cracks.
+float edgeLevel(vec2 from, vec2 to) {
+    vec2 first = toPixels(gridPoint(from));
+    vec2 last = toPixels(gridPoint(to));
+    vec2 middle = toPixels(gridPoint((from + to) / 2));
+    float miss = length(middle - (first + last) / 2);
+    return clamp(sqrt(miss / pixelError), 1, maxTessLevel);
+}
+
+void main() {
+    patchCoord[gl_InvocationID] = gridCoord[gl_InvocationID];
+    if (gl_InvocationID != 0) {
+        return;
+    }
+
+    // Outer levels go along u = 0, v = 0, u = 1 and v = 1
+    gl_TessLevelOuter[0] = edgeLevel(gridCoord[0], gridCoord[3]);
+    gl_TessLevelOuter[1] = edgeLevel(gridCoord[0], gridCoord[1]);
+    gl_TessLevelOuter[2] = edgeLevel(gridCoord[1], gridCoord[2]);
+    gl_TessLevelOuter[3] = edgeLevel(gridCoord[3], gridCoord[2]);
+    gl_TessLevelInner[0] = max(gl_TessLevelOuter[1], gl_TessLevelOuter[3]);
+    gl_TessLevelInner[1] = max(gl_TessLevelOuter[0], gl_TessLevelOuter[2]);
+}
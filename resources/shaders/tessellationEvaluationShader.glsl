@@ -0,0 +1,56 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#version 400
+
+// Patches go counter-clockwise seen from outside in the quad domain
+layout(quads, fractional_odd_spacing, ccw) in;
+
+uniform highp mat4x4 transformMatrix;
+uniform highp mat4x4 rotateMatrix;
+uniform highp vec3 axes;
+uniform highp vec2 heightRange;
+uniform int patchSegments;
+uniform int patchBands;
+
+in vec2 patchCoord[];
+
+out highp vec4 normal;
+out highp vec4 point;
+out highp vec4 tint;
+
+const highp float PI = 3.14159265f;
+
+// Same surface as the tessellation control shader
+vec3 gridPoint(vec2 grid) {
+    float phi = 2 * PI * mod(grid.x, float(patchSegments)) / patchSegments;
+    float band = clamp(grid.y - 1, 0, patchBands);
+    float h = mix(heightRange.x, heightRange.y, band / patchBands);
+    float radius = sqrt((axes.z * axes.z - h * h) / axes.z * axes.z);
+    vec2 rim = radius * axes.xy * vec2(cos(phi), sin(phi));
+    // Caps shrink the rim from 1 at the side bands to 0 at the centers
+    float capScale = clamp(min(grid.y, patchBands + 2 - grid.y), 0, 1);
+    return vec3(rim * capScale, h);
+}
+
+void main() {
+    // The corner is a whole number, so shared edges get equal points
+    vec2 grid = patchCoord[0] + gl_TessCoord.xy;
+    vec3 p = gridPoint(grid);
+
+    // Caps are flat, side bands use the analytic normal
+    int row = gl_PrimitiveID / patchSegments;
+    vec3 n = normalize(vec3(p.xy / (axes.xy * axes.xy), p.z));
+    if (row == 0) {
+        n = vec3(0, 0, -1);
+    } else if (row == patchBands + 1) {
+        n = vec3(0, 0, 1);
+    }
+
+    point = vec4(p, 1) * rotateMatrix;
+    normal = vec4(n, 1) * rotateMatrix;
+    tint = vec4(0);
+    gl_Position = point * transformMatrix;
+}
@@ -0,0 +1,22 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#version 400
+
+uniform int patchSegments;
+
+// Grid position of the patch corner. X goes around OZ, y goes from the
+// bottom cap center through the side bands to the top cap center.
+out vec2 gridCoord;
+
+// Corners of a patch, counter-clockwise in the quad domain
+const vec2 PATCH_CORNERS[4] = vec2[4](vec2(0, 0), vec2(1, 0),
+                                      vec2(1, 1), vec2(0, 1));
+
+void main() {
+    int patchIndex = gl_VertexID / 4;
+    vec2 origin = vec2(patchIndex % patchSegments, patchIndex / patchSegments);
+    gridCoord = origin + PATCH_CORNERS[gl_VertexID % 4];
+}
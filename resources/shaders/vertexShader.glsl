@@ -7,14 +7,98 @@
 
 attribute highp vec4 position;
 attribute highp vec4 color;
+// Per-instance attributes of the instanced mode. Other modes disable
+// their arrays and set constants that leave the mesh unchanged.
+attribute highp vec3 instanceOffset;
+attribute highp vec3 instanceScale;
+attribute highp vec4 instanceRotation;
+attribute highp vec4 instanceColor;
 
 uniform highp mat4x4 transformMatrix;
+uniform highp mat4x4 rotateMatrix;
+
+// Procedural mode: the mesh of the indexed mode is derived from
+// gl_VertexID, position and color arrays aren't used
+uniform bool procedural = false;
+uniform highp vec3 axes;
+uniform int segmentCount;
+uniform int ringCount;
+uniform highp float ringStart;
+uniform highp float ringStep;
 
 varying highp vec4 normal;
 varying highp vec4 point;
+varying highp vec4 tint;
+
+const highp float PI = 3.14159265f;
+
+// Corners of the two triangles of a side quad as (segment, ring) offsets
+const ivec2 SIDE_CORNERS[6] = ivec2[6](ivec2(0, 0), ivec2(1, 0),
+                                       ivec2(0, 1), ivec2(1, 0),
+                                       ivec2(1, 1), ivec2(0, 1));
+
+float ringHeight(int ring) {
+    return ringStart + ring * ringStep;
+}
+
+// Same radius factor as Layer::GenerateRing
+vec3 ringPoint(int ring, int segment) {
+    float h = ringHeight(ring);
+    float radius = sqrt((axes.z * axes.z - h * h) / axes.z * axes.z);
+    float phi = 2 * PI * (segment % segmentCount) / segmentCount;
+    return vec3(radius * axes.x * cos(phi), radius * axes.y * sin(phi), h);
+}
+
+// Side quads go ring by ring, then the bottom and the top caps follow.
+// Triangles are wound counter-clockwise seen from outside.
+void generateVertex(out vec4 vertexPosition, out vec4 vertexNormal) {
+    int triangle = gl_VertexID / 3;
+    int corner = gl_VertexID % 3;
+    int sideTriangles = 2 * segmentCount * (ringCount - 1);
+
+    if (triangle < sideTriangles) {
+        int quad = triangle / 2;
+        ivec2 offset = SIDE_CORNERS[triangle % 2 * 3 + corner];
+        vec3 p = ringPoint(quad / segmentCount + offset.y,
+                           quad % segmentCount + offset.x);
+        // Analytic normal of x^2 / a^2 + y^2 / b^2 + z^2 = c^2
+        vertexPosition = vec4(p, 1);
+        vertexNormal = vec4(normalize(vec3(p.xy / (axes.xy * axes.xy), p.z)),
+                            1);
+        return;
+    }
+
+    int cap = (triangle - sideTriangles) / segmentCount;
+    int segment = (triangle - sideTriangles) % segmentCount;
+    int ring = cap == 0 ? 0 : ringCount - 1;
+    // The bottom cap faces -OZ, so its corners go the other way
+    bool next = (corner == 1) == (cap == 0);
+    vertexPosition = corner == 0
+        ? vec4(0, 0, ringHeight(ring), 1)
+        : vec4(ringPoint(ring, segment + (next ? 1 : 0)), 1);
+    vertexNormal = vec4(0, 0, cap == 0 ? -1 : 1, 1);
+}
+
+// Rotates v by the unit quaternion q
+vec3 rotate(vec4 q, vec3 v) {
+    return v + 2 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
 
 void main() {
-    point = position;
-    normal = color;
-    gl_Position = position * transformMatrix;
+    vec4 vertexPosition = position;
+    vec4 vertexNormal = color;
+    if (procedural) {
+        generateVertex(vertexPosition, vertexNormal);
+    }
+
+    vec3 local = rotate(instanceRotation, vertexPosition.xyz * instanceScale);
+    // Normals scale inversely, the original length is kept for lighting
+    vec3 localNormal =
+        rotate(instanceRotation, vertexNormal.xyz / instanceScale);
+    localNormal = normalize(localNormal) * length(vertexNormal.xyz);
+
+    point = vec4(local + instanceOffset, vertexPosition.w) * rotateMatrix;
+    normal = vec4(localNormal, vertexNormal.w) * rotateMatrix;
+    tint = instanceColor;
+    gl_Position = point * transformMatrix;
 }
@@ -0,0 +1,92 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <AsyncMeshBuilder.hpp>
+
+#include <chrono>
+
+AsyncMeshBuilder::AsyncMeshBuilder(const Ellipsoid& ellipsoid,
+                                   Callback onReady)
+    : Generator{ellipsoid},
+      OnReady{std::move(onReady)},
+      Back{0},
+      Front{1},
+      Middle{2},
+      CancelledCount{0},
+      Stopped{false},
+      Worker{&AsyncMeshBuilder::WorkerLoop, this} {}
+
+AsyncMeshBuilder::~AsyncMeshBuilder() {
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Stopped = true;
+    }
+    Condition.notify_one();
+    Worker.join();
+}
+
+void AsyncMeshBuilder::Request(const MeshRequest& request) {
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        if (Pending) {
+            CancelledCount++;
+        }
+        Pending = request;
+    }
+    Condition.notify_one();
+}
+
+const AsyncMeshBuilder::MeshResult* AsyncMeshBuilder::Take() {
+    if (!(Middle.load(std::memory_order_acquire) & FRESH)) {
+        return nullptr;
+    }
+    // Give the drawn buffer back and take the published one
+    Front = Middle.exchange(Front, std::memory_order_acq_rel) & INDEX_MASK;
+    return &Buffers[Front];
+}
+
+void AsyncMeshBuilder::WorkerLoop() {
+    std::unique_lock<std::mutex> lock(Mutex);
+    while (true) {
+        Condition.wait(lock, [this]() { return Stopped || Pending; });
+        if (Stopped) {
+            return;
+        }
+
+        const auto request = *Pending;
+        Pending.reset();
+        lock.unlock();
+
+        Build(request, Buffers[Back]);
+        // Publish, getting either the old published buffer or the one
+        // the reader has just returned
+        Back = Middle.exchange(Back | FRESH, std::memory_order_acq_rel) &
+               INDEX_MASK;
+        if (OnReady) {
+            OnReady();
+        }
+
+        lock.lock();
+    }
+}
+
+void AsyncMeshBuilder::Build(const MeshRequest& request, MeshResult& result) {
+    const auto start = std::chrono::steady_clock::now();
+
+    Generator.SetVertexCount(request.VertexCount);
+    Generator.SetSurfaceCount(request.SurfaceCount);
+    if (request.Indexed) {
+        result.Mesh = Generator.GenerateIndexedMesh();
+    } else if (request.RotateMatrix) {
+        Generator.GenerateVertices(*request.RotateMatrix, result.Arena);
+    } else {
+        Generator.GenerateMesh(result.Arena);
+    }
+    result.Request = request;
+
+    result.BuildTime = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+}
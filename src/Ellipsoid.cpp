@@ -2,32 +2,44 @@
 
 #include <algorithm>
 #include <cmath>
-#include <future>
+#include <limits>
 #include <vector>
 
-const float Layer::PI = 4 * std::atan(1.0f);
+const float RingTable::PI = 4 * std::atan(1.0f);
+
+RingTable::RingTable(SizeType n) : SegmentCount{n}, Cos(n + 1), Sin(n + 1) {
+    const auto DELTA_PHI = 2 * PI / n;
+    for (auto i = 0UL; i <= n; i++) {
+        Cos[i] = std::cos(i * DELTA_PHI);
+        Sin[i] = std::sin(i * DELTA_PHI);
+    }
+}
 
 Layer::Layer(LenghtType a,
              LenghtType b,
              LenghtType c,
              LenghtType h,
-             SizeType n,
+             const RingTable& ring,
              LenghtType deltaH,
              const Mat4x4& transformMatrix,
-             const Vec3& viewPoint)
+             const OptionalViewPoint& viewPoint)
     : Type{LayerType::SIDE} {
-    GenerateVertices(a, b, c, h, n, deltaH, transformMatrix, viewPoint);
+    Vertices.resize(GetMaxVertexCount(Type, ring.GetSegmentCount()));
+    Vertices.resize(WriteVertices(a, b, c, h, ring, deltaH, transformMatrix,
+                                  viewPoint, Vertices.data()));
 }
 
 Layer::Layer(LenghtType a,
              LenghtType b,
              LenghtType c,
              LenghtType h,
-             SizeType n,
+             const RingTable& ring,
              const Mat4x4& transformMatrix,
-             const Vec3& viewPoint)
+             const OptionalViewPoint& viewPoint)
     : Type{LayerType::BOTTOM} {
-    GenerateVertices(a, b, c, h, n, transformMatrix, viewPoint);
+    Vertices.resize(GetMaxVertexCount(Type, ring.GetSegmentCount()));
+    Vertices.resize(WriteVertices(a, b, c, h, ring, transformMatrix,
+                                  viewPoint, Vertices.data()));
 }
 
 const VertexVector& Layer::GetVertices() const {
@@ -39,86 +51,134 @@ SizeType Layer::GetItemsCount() const {
 }
 
 Layer Layer::ApplyMatrix(const Mat4x4& matrix) const {
+    PositionArray positions(Vertices.size());
+    for (auto i = 0UL; i < Vertices.size(); i++) {
+        const auto position = Vertices[i].GetPosition();
+        positions.Set(i, position[0], position[1], position[2]);
+    }
+    TransformKernel::Transform(positions, matrix, positions);
+
     Layer layer;
-    for (auto&& vertex : Vertices) {
-        layer.Vertices.emplace_back(vertex.GetPosition() * matrix,
-                                    vertex.GetColor());
+    layer.Type = Type;
+    layer.Vertices.reserve(Vertices.size());
+    for (auto i = 0UL; i < Vertices.size(); i++) {
+        layer.Vertices.emplace_back(positions.Get(i), Vertices[i].GetColor());
     }
     return layer;
 }
 
-void Layer::GenerateVertices(LenghtType a,
-                             LenghtType b,
-                             LenghtType c,
-                             LenghtType h,
-                             SizeType n,
-                             LenghtType deltaH,
-                             const Mat4x4& rotateMatrix,
-                             const Vec3& viewPoint) {
-    const auto DELTA_PHI = 2 * PI / n;
+SizeType Layer::GetMaxVertexCount(LayerType type, SizeType n) {
+    // Two triangles per side segment, one per bottom segment
+    return type == LayerType::SIDE ? 6 * n : 3 * n;
+}
 
-    auto generateVertex = [a, b, c, DELTA_PHI](auto&& i, auto&& h) {
-        const auto C = (c * c - h * h) / c * c;
-        const auto A = std::sqrt(C) * a;
-        const auto B = std::sqrt(C) * b;
-        return Vertex(A * std::cos(i * DELTA_PHI), B * std::sin(i * DELTA_PHI),
-                      h);
-    };
+SizeType Layer::WriteVertices(LenghtType a,
+                              LenghtType b,
+                              LenghtType c,
+                              LenghtType h,
+                              const RingTable& ring,
+                              LenghtType deltaH,
+                              const Mat4x4& rotateMatrix,
+                              const OptionalViewPoint& viewPoint,
+                              Vertex* output) {
+    const auto n = ring.GetSegmentCount();
+
+    // Lower ring takes [0, n], upper ring takes [n + 1, 2n + 1]
+    auto& positions = GetScratchPositions(2 * (n + 1));
+    GenerateRing(a, b, c, h, ring, 0, positions);
+    GenerateRing(a, b, c, h + deltaH, ring, n + 1, positions);
+    TransformKernel::Transform(positions, rotateMatrix, positions);
 
+    SizeType count = 0;
     for (auto i = 0UL; i < n; i++) {
-        auto first = generateVertex(i, h).GetPosition() * rotateMatrix;
-        auto second =
-            generateVertex(i, h + deltaH).GetPosition() * rotateMatrix;
-        auto third = generateVertex(i + 1, h).GetPosition() * rotateMatrix;
-        auto fourth =
-            generateVertex(i + 1, h + deltaH).GetPosition() * rotateMatrix;
-
-        Vec3 normal = GetNormal(first, second, third);
-        if (CheckNormal(normal, viewPoint)) {
-            Vertices.emplace_back(first, ToVec4(normal));
-            Vertices.emplace_back(second, ToVec4(normal));
-            Vertices.emplace_back(third, ToVec4(normal));
-        }
+        const Vec4 first = positions.Get(i);
+        const Vec4 second = positions.Get(n + 1 + i);
+        const Vec4 third = positions.Get(i + 1);
+        const Vec4 fourth = positions.Get(n + 2 + i);
 
-        normal = GetNormal(second, fourth, third);
-        if (CheckNormal(normal, viewPoint)) {
-            Vertices.emplace_back(second, ToVec4(normal));
-            Vertices.emplace_back(fourth, ToVec4(normal));
-            Vertices.emplace_back(third, ToVec4(normal));
-        }
+        count += AddTriangle(first, second, third, viewPoint, output + count);
+        count += AddTriangle(second, fourth, third, viewPoint, output + count);
     }
+    return count;
 }
 
-void Layer::GenerateVertices(LenghtType a,
-                             LenghtType b,
-                             LenghtType c,
-                             LenghtType h,
-                             SizeType n,
-                             const Mat4x4& rotateMatrix,
-                             const Vec3& viewPoint) {
-    const auto DELTA_PHI = 2 * PI / n;
+SizeType Layer::WriteVertices(LenghtType a,
+                              LenghtType b,
+                              LenghtType c,
+                              LenghtType h,
+                              const RingTable& ring,
+                              const Mat4x4& rotateMatrix,
+                              const OptionalViewPoint& viewPoint,
+                              Vertex* output) {
+    const auto n = ring.GetSegmentCount();
 
-    auto generateVertex = [a, b, c, DELTA_PHI](auto&& i, auto&& h) {
-        const auto C = (c * c - h * h) / c * c;
-        const auto A = std::sqrt(C) * a;
-        const auto B = std::sqrt(C) * b;
-        return Vertex(A * std::cos(i * DELTA_PHI), B * std::sin(i * DELTA_PHI),
-                      h);
-    };
+    // Ring takes [0, n], the center is the last one
+    auto& positions = GetScratchPositions(n + 2);
+    GenerateRing(a, b, c, h, ring, 0, positions);
+    positions.Set(n + 1, 0, 0, h);
+    TransformKernel::Transform(positions, rotateMatrix, positions);
 
-    const Vec4 center = Vec4(0, 0, h, 1) * rotateMatrix;
+    const Vec4 center = positions.Get(n + 1);
 
+    SizeType count = 0;
     for (auto i = 0UL; i < n; i++) {
-        auto first = generateVertex(i, h).GetPosition() * rotateMatrix;
-        auto second = generateVertex(i + 1, h).GetPosition() * rotateMatrix;
-
-        Vec3 normal = GetNormal(first, center, second);
-        if (CheckNormal(normal, viewPoint)) {
-            Vertices.emplace_back(first, ToVec4(normal));
-            Vertices.emplace_back(center, ToVec4(normal));
-            Vertices.emplace_back(second, ToVec4(normal));
-        }
+        const Vec4 first = positions.Get(i);
+        const Vec4 second = positions.Get(i + 1);
+
+        count += AddTriangle(first, center, second, viewPoint, output + count);
     }
+    return count;
+}
+
+PositionArray& Layer::GetScratchPositions(SizeType size) {
+    // Vectors only grow, so a thread allocates until it has seen the
+    // biggest layer
+    thread_local PositionArray positions;
+    positions.Resize(size);
+    return positions;
+}
+
+void Layer::GenerateRing(LenghtType a,
+                         LenghtType b,
+                         LenghtType c,
+                         LenghtType h,
+                         const RingTable& ring,
+                         SizeType offset,
+                         PositionArray& positions) {
+    // Radius factor is evaluated once per ring, angles come from the table
+    const auto C = (c * c - h * h) / c * c;
+    const auto A = std::sqrt(C) * a;
+    const auto B = std::sqrt(C) * b;
+    auto& cos = ring.GetCos();
+    auto& sin = ring.GetSin();
+
+    for (auto i = 0UL; i <= ring.GetSegmentCount(); i++) {
+        positions.Set(offset + i, A * cos[i], B * sin[i], h);
+    }
+}
+
+SizeType Layer::AddTriangle(const Vec4& first,
+                            const Vec4& middle,
+                            const Vec4& last,
+                            const OptionalViewPoint& viewPoint,
+                            Vertex* output) {
+    Vec3 normal = GetNormal(first, middle, last);
+    if (!CheckNormal(normal, viewPoint)) {
+        return 0;
+    }
+
+    // Keep counter-clockwise order seen from outside for GL face culling
+    const Vec3 orderNormal = ToVec3(middle - first).cross(ToVec3(last - first));
+    const Vec4 color = ToVec4(normal);
+    output[0] = Vertex(first, color);
+    if (orderNormal.dot(normal) >= 0) {
+        output[1] = Vertex(middle, color);
+        output[2] = Vertex(last, color);
+    } else {
+        output[1] = Vertex(last, color);
+        output[2] = Vertex(middle, color);
+    }
+    return 3;
 }
 
 Vec3 Layer::GetNormal(const Vec4& first, const Vec4& middle, const Vec4& last) {
@@ -137,72 +197,298 @@ Vec3 Layer::GetNormal(const Vec4& first, const Vec4& middle, const Vec4& last) {
     return normal;
 }
 
-bool Layer::CheckNormal(const Vec3& normal, const Vec3& viewPoint) {
-    float dotProduct = viewPoint.dot(normal);
+bool Layer::CheckNormal(const Vec3& normal,
+                        const OptionalViewPoint& viewPoint) {
+    // Without view point every triangle is kept
+    if (!viewPoint) {
+        return true;
+    }
+
+    float dotProduct = viewPoint->dot(normal);
     if (dotProduct > 0) {
         return true;
     }
     return false;
 }
 
+IndexedMesh::IndexedMesh(VertexVector&& vertices, const IndexVector& indices)
+    : Vertices{std::move(vertices)} {
+    if (Vertices.size() <= std::numeric_limits<std::uint16_t>::max() + 1UL) {
+        ShortIndices.assign(indices.begin(), indices.end());
+    } else {
+        Indices = indices;
+    }
+}
+
+const void* IndexedMesh::GetIndexData() const {
+    if (HasShortIndices()) {
+        return ShortIndices.data();
+    }
+    return Indices.data();
+}
+
+SizeType IndexedMesh::GetIndexCount() const {
+    return HasShortIndices() ? ShortIndices.size() : Indices.size();
+}
+
+SizeType IndexedMesh::GetIndexSize() const {
+    return HasShortIndices() ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+}
+
+SizeType IndexedMesh::GetByteSize() const {
+    return Vertices.size() * sizeof(Vertex) +
+           GetIndexCount() * GetIndexSize();
+}
+
+void VertexArena::Reset(SizeType layerCount, SizeType maxVertexCount) {
+    // Never shrinks, smaller meshes reuse the bigger storage
+    if (Vertices.size() < maxVertexCount) {
+        Vertices.resize(maxVertexCount);
+    }
+    Layers.resize(layerCount);
+    VertexCount = 0;
+}
+
+SizeType VertexArena::GetByteSize() const {
+    return Vertices.capacity() * sizeof(Vertex) +
+           Layers.capacity() * sizeof(LayerRange);
+}
+
+void VertexArena::SetLayer(SizeType index, SizeType offset, SizeType count) {
+    Layers[index] = {offset, count};
+}
+
+void VertexArena::Compact() {
+    VertexCount = 0;
+    for (auto&& layer : Layers) {
+        // Destination is never after the source, so forward moves are safe
+        if (layer.Offset != VertexCount) {
+            std::move(Vertices.begin() + layer.Offset,
+                      Vertices.begin() + layer.Offset + layer.Count,
+                      Vertices.begin() + VertexCount);
+            layer.Offset = VertexCount;
+        }
+        VertexCount += layer.Count;
+    }
+}
+
 Ellipsoid::Ellipsoid(LenghtType a,
                      LenghtType b,
                      LenghtType c,
                      SizeType vertexCount,
                      SizeType surfaceCount,
-                     const Vec3& viewPoint)
+                     const Vec3& viewPoint,
+                     std::shared_ptr<ThreadPool> pool)
     : A{a},
       B{b},
       C{c},
       VertexCount{vertexCount},
       SurfaceCount{surfaceCount},
-      ViewPoint{viewPoint} {}
+      Ring{std::make_shared<RingTable>(vertexCount)},
+      ViewPoint{viewPoint},
+      Pool{pool ? std::move(pool) : ThreadPool::GetDefault()} {
+    Heights = GenerateRingHeights();
+}
 
 LayerVector Ellipsoid::GenerateVertices(const Mat4x4& rotateMatrix) const {
-    LayerVector layers;
-    float start = -0.1f;
-    float stop = 0.1f;
+    return GenerateLayers(rotateMatrix, ViewPoint);
+}
+
+LayerVector Ellipsoid::GenerateMesh() const {
+    return GenerateLayers(Mat4x4::Identity(), std::nullopt);
+}
+
+void Ellipsoid::GenerateVertices(const Mat4x4& rotateMatrix,
+                                 VertexArena& arena) const {
+    GenerateLayers(rotateMatrix, ViewPoint, arena);
+}
+
+void Ellipsoid::GenerateMesh(VertexArena& arena) const {
+    GenerateLayers(Mat4x4::Identity(), std::nullopt, arena);
+}
+
+IndexedMesh Ellipsoid::GenerateIndexedMesh() const {
+    const auto& heights = Heights;
+    const auto ringCount = heights.size();
+    auto& cos = Ring->GetCos();
+    auto& sin = Ring->GetSin();
+
+    VertexVector vertices;
+    IndexedMesh::IndexVector indices;
+    vertices.reserve(ringCount * VertexCount + 2 * (VertexCount + 1));
+    indices.reserve(6 * (ringCount - 1) * VertexCount + 6 * VertexCount);
+
+    // One vertex per (ring, segment) with the analytic surface normal
+    // (x / a^2, y / b^2, z) of x^2 / a^2 + y^2 / b^2 + z^2 = c^2
+    for (auto h : heights) {
+        const auto radius = std::sqrt((C * C - h * h) / C * C);
+        for (auto i = 0UL; i < VertexCount; i++) {
+            const auto x = radius * A * cos[i];
+            const auto y = radius * B * sin[i];
+            Vec3 normal = Vec3(x / (A * A), y / (B * B), h);
+            normal.normalize();
+            const Vec4 color = Vec4(normal[0], normal[1], normal[2], 1);
+            vertices.emplace_back(Vec4(x, y, h, 1), color);
+        }
+    }
+
+    // Triangles are wound counter-clockwise seen from outside
+    auto ringVertex = [this](auto ring, auto segment) {
+        return static_cast<std::uint32_t>(ring * VertexCount +
+                                          segment % VertexCount);
+    };
+    for (auto ring = 0UL; ring + 1 < ringCount; ring++) {
+        for (auto i = 0UL; i < VertexCount; i++) {
+            indices.insert(indices.end(),
+                           {ringVertex(ring, i), ringVertex(ring, i + 1),
+                            ringVertex(ring + 1, i), ringVertex(ring, i + 1),
+                            ringVertex(ring + 1, i + 1),
+                            ringVertex(ring + 1, i)});
+        }
+    }
+
+    // Caps need their own ring copies because of the flat normal
+    for (auto ring : {0UL, ringCount - 1}) {
+        const auto h = heights[ring];
+        const auto normalZ = ring == 0 ? -1.0f : 1.0f;
+        const auto center = static_cast<std::uint32_t>(vertices.size());
+
+        vertices.emplace_back(Vec4(0, 0, h, 1), Vec4(0, 0, normalZ, 1));
+        for (auto i = 0UL; i < VertexCount; i++) {
+            vertices.emplace_back(
+                vertices[ringVertex(ring, i)].GetPosition(),
+                Vec4(0, 0, normalZ, 1));
+        }
+
+        for (auto i = 0UL; i < VertexCount; i++) {
+            const auto first = static_cast<std::uint32_t>(center + 1 + i);
+            const auto second = static_cast<std::uint32_t>(
+                center + 1 + (i + 1) % VertexCount);
+            if (ring == 0) {
+                indices.insert(indices.end(), {center, second, first});
+            } else {
+                indices.insert(indices.end(), {center, first, second});
+            }
+        }
+    }
+
+    return IndexedMesh(std::move(vertices), indices);
+}
+
+std::vector<LenghtType> Ellipsoid::GenerateRingHeights() const {
+    std::vector<LenghtType> heights;
+    float start = MIN_HEIGHT;
+    float stop = MAX_HEIGHT;
     float delta = (stop - start) / SurfaceCount;
     auto height = start;
 
+    for (height = start; height <= stop; height += delta) {
+        heights.push_back(height);
+    }
+    // top of the last layer
+    heights.push_back(height);
+
+    return heights;
+}
+
+LayerVector Ellipsoid::GenerateLayers(
+    const Mat4x4& rotateMatrix,
+    const OptionalViewPoint& viewPoint) const {
+    LayerVector layers;
+    const auto& heights = Heights;
+    layers.reserve(heights.size() + 1);
+
     std::vector<std::future<Layer>> futures;
+    futures.reserve(heights.size() - 1);
 
-    for (height = start; height <= stop; height += delta) {
-        futures.emplace_back(std::async(
-            std::launch::async,
-            [](float a, float b, float c, float height, SizeType vertexCount,
-               float delta, const Mat4x4& transformMatrix,
-               const Vec3& viewPoint) {
-                return Layer(a, b, c, height, vertexCount, delta,
-                             transformMatrix, viewPoint);
-            },
-            A, B, C, height, VertexCount, delta, rotateMatrix, ViewPoint));
+    for (auto i = 0UL; i + 1 < heights.size(); i++) {
+        const auto height = heights[i];
+        const auto delta = heights[i + 1] - height;
+        auto generateLayer = [this, height, delta, &rotateMatrix,
+                              &viewPoint]() {
+            return Layer(A, B, C, height, *Ring, delta, rotateMatrix,
+                         viewPoint);
+        };
+
+        if (Pool) {
+            futures.emplace_back(Pool->Submit(generateLayer));
+        } else {
+            std::promise<Layer> promise;
+            promise.set_value(generateLayer());
+            futures.emplace_back(promise.get_future());
+        }
     }
 
     for (auto&& future : futures) {
-        future.wait();
         auto layer = future.get();
         if (layer.GetItemsCount() != 0) {
-            layers.emplace_back(layer);
+            layers.emplace_back(std::move(layer));
         }
     }
 
-    for (auto h : {start, height}) {
+    for (auto h : {heights.front(), heights.back()}) {
         auto layer =
-            Layer(A, B, C, h, VertexCount, rotateMatrix, ViewPoint);
+            Layer(A, B, C, h, *Ring, rotateMatrix, viewPoint);
         if (layer.GetItemsCount() != 0) {
-            layers.emplace_back(layer);
+            layers.emplace_back(std::move(layer));
         }
     }
     return layers;
 }
 
+void Ellipsoid::GenerateLayers(const Mat4x4& rotateMatrix,
+                               const OptionalViewPoint& viewPoint,
+                               VertexArena& arena) const {
+    using LayerType = Layer::LayerType;
+
+    // Side layers first, then the bottom and the top caps
+    const auto sideCount = Heights.size() - 1;
+    const auto sideSize =
+        Layer::GetMaxVertexCount(LayerType::SIDE, VertexCount);
+    const auto capSize =
+        Layer::GetMaxVertexCount(LayerType::BOTTOM, VertexCount);
+    arena.Reset(sideCount + 2, sideCount * sideSize + 2 * capSize);
+
+    auto generateLayer = [&](SizeType i) {
+        SizeType offset = 0;
+        SizeType count = 0;
+        if (i < sideCount) {
+            offset = i * sideSize;
+            count = Layer::WriteVertices(
+                A, B, C, Heights[i], *Ring, Heights[i + 1] - Heights[i],
+                rotateMatrix, viewPoint, arena.GetSlot(offset));
+        } else {
+            const auto cap = i - sideCount;
+            const auto h = cap == 0 ? Heights.front() : Heights.back();
+            offset = sideCount * sideSize + cap * capSize;
+            count = Layer::WriteVertices(A, B, C, h, *Ring, rotateMatrix,
+                                         viewPoint, arena.GetSlot(offset));
+        }
+        arena.SetLayer(i, offset, count);
+    };
+
+    if (Pool) {
+        Pool->ParallelFor(sideCount + 2, generateLayer);
+    } else {
+        for (auto i = 0UL; i < sideCount + 2; i++) {
+            generateLayer(i);
+        }
+    }
+    arena.Compact();
+}
+
 void Ellipsoid::SetVertexCount(SizeType count) {
+    if (count != VertexCount) {
+        Ring = std::make_shared<RingTable>(count);
+    }
     VertexCount = count;
 }
 
 void Ellipsoid::SetSurfaceCount(SizeType count) {
-    SurfaceCount = count;
+    if (count != SurfaceCount) {
+        SurfaceCount = count;
+        Heights = GenerateRingHeights();
+    }
 }
 
 LayerVector Ellipsoid::ApplyMatrix(const LayerVector& layers,
@@ -0,0 +1,1249 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <EllipsoidRenderer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <QDebug>
+#include <QMatrix4x4>
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+#ifndef GL_PRIMITIVES_GENERATED
+#define GL_PRIMITIVES_GENERATED 0x8C87
+#endif
+#ifndef GL_PATCHES
+#define GL_PATCHES 0x000E
+#endif
+#ifndef GL_PATCH_VERTICES
+#define GL_PATCH_VERTICES 0x8E72
+#endif
+#ifndef GL_MAX_TESS_GEN_LEVEL
+#define GL_MAX_TESS_GEN_LEVEL 0x8E7E
+#endif
+
+const Vec3 EllipsoidRenderer::VIEW_POINT = Vec3(0, 0, 1);
+
+EllipsoidRenderer::EllipsoidRenderer(LenghtType a,
+                                     LenghtType b,
+                                     LenghtType c,
+                                     SizeType vertexCount,
+                                     SizeType surfaceCount)
+    : InitializationTime{0},
+      MeshProgram{nullptr},
+      TessellationProgram{nullptr},
+      ImpostorProgram{nullptr},
+      ShaderProgram{nullptr},
+      Buffer{nullptr},
+      IndexBuffer{nullptr},
+      InstanceBuffer{nullptr},
+      VertexArray{nullptr},
+      EmptyVertexArray{nullptr},
+      VertexBufferCapacity{0},
+      IndexBufferCapacity{0},
+      InstanceBufferCapacity{0},
+      PositionAttribute{-1},
+      ColorAttribute{-1},
+      InstanceOffsetAttribute{-1},
+      InstanceScaleAttribute{-1},
+      InstanceRotationAttribute{-1},
+      InstanceColorAttribute{-1},
+      RotateMatrixUniform{-1},
+      TransformMatrixUniform{-1},
+      TimeUniform{-1},
+      ProceduralUniform{-1},
+      AxesUniform{-1},
+      SegmentCountUniform{-1},
+      RingCountUniform{-1},
+      RingStartUniform{-1},
+      RingStepUniform{-1},
+      HeightRangeUniform{-1},
+      PatchSegmentsUniform{-1},
+      PatchBandsUniform{-1},
+      ViewportSizeUniform{-1},
+      PixelErrorUniform{-1},
+      MaxTessLevelUniform{-1},
+      MaxTessLevel{0},
+      LightingBuffer{0},
+      EllipsoidLayer{a, b, c, vertexCount, surfaceCount, VIEW_POINT},
+      BoundingRadius{std::max(a, b) * c},
+      ScaleFactor{3.0f},
+      AngleOX{0.0},
+      AngleOY{0.0},
+      AngleOZ{0.0},
+      AmbientCoeff{0.2},
+      SpecularCoeff{0.2},
+      DiffuseCoeff{0.3},
+      Time{0},
+      VertexCount{vertexCount},
+      SurfaceCount{surfaceCount},
+      Width{0},
+      Height{0},
+      DirtyFlags{ALL},
+      UniformFlags{CLEAN},
+      GeometryChanged{true},
+      VertexLayoutChanged{true},
+      UploadedVertexCount{0},
+      RotateMatrix{Mat4x4::Identity()},
+      TransformMatrix{Mat4x4::Identity()},
+      Lod{a, b, c},
+      Level{vertexCount, surfaceCount},
+      FrontArena{0},
+      CachedMeshes{RenderOptions().MeshCacheBytes},
+      DrawArena{&Arenas[0]},
+      DrawMesh{&Mesh},
+      MeshVersion{0},
+      DrawnVersion{0},
+      HasTimerQueries{false},
+      TimerQueries{},
+      TimerPending{},
+      PrimitiveQueries{},
+      PrimitivePending{},
+      TessellatedTriangleCount{0},
+      TimerFrame{0},
+      TimingFrame{false},
+      GenerationAverage{AVERAGE_WINDOW},
+      UploadAverage{AVERAGE_WINDOW},
+      DrawAverage{AVERAGE_WINDOW},
+      GpuUploadAverage{AVERAGE_WINDOW},
+      GpuDrawAverage{AVERAGE_WINDOW},
+      TriangleAverage{AVERAGE_WINDOW} {}
+
+EllipsoidRenderer::~EllipsoidRenderer() {
+    CleanUp();
+}
+
+bool EllipsoidRenderer::Initialize() {
+    const auto start = Clock::now();
+    initializeOpenGLFunctions();
+    Shaders.Initialize(Options.CacheShaders);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    MeshProgram = new QOpenGLShaderProgram;
+    const ShaderCache::ShaderList shaders = {
+        {QOpenGLShader::Vertex, VERTEX_SHADER},
+        {QOpenGLShader::Fragment, FRAGMENT_SHADER}};
+    if (!Shaders.Link(*MeshProgram, shaders)) {
+        qDebug() << MeshProgram->log();
+        return false;
+    }
+    BindLightingBlock(MeshProgram);
+    CreateTessellationProgram();
+
+    // Names are resolved once per program, frames use the cached locations
+    ShaderProgram = MeshProgram;
+    ResolveUniforms();
+
+    glGenBuffers(1, &LightingBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, LightingBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(LightingBlock), nullptr,
+                 GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTING_BINDING, LightingBuffer);
+
+    CreateTimerQueries();
+
+    // Buffers and the vertex array live as long as the context does
+    Buffer = new QOpenGLBuffer;
+    Buffer->create();
+    Buffer->setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    IndexBuffer = new QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+    IndexBuffer->create();
+    IndexBuffer->setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    InstanceBuffer = new QOpenGLBuffer;
+    InstanceBuffer->create();
+    InstanceBuffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
+    VertexBufferCapacity = 0;
+    IndexBufferCapacity = 0;
+    InstanceBufferCapacity = 0;
+
+    VertexArray = new QOpenGLVertexArrayObject;
+    VertexArray->create();
+    VertexArray->bind();
+    Buffer->bind();
+    IndexBuffer->bind();
+
+    PositionAttribute = MeshProgram->attributeLocation(POSITION);
+    ColorAttribute = MeshProgram->attributeLocation(COLOR);
+    InstanceOffsetAttribute = MeshProgram->attributeLocation(INSTANCE_OFFSET);
+    InstanceScaleAttribute = MeshProgram->attributeLocation(INSTANCE_SCALE);
+    InstanceRotationAttribute =
+        MeshProgram->attributeLocation(INSTANCE_ROTATION);
+    InstanceColorAttribute = MeshProgram->attributeLocation(INSTANCE_COLOR);
+    SetupVertexAttributes();
+
+    VertexArray->release();
+    Buffer->release();
+
+    // Core profiles need a bound vertex array even when nothing is read
+    EmptyVertexArray = new QOpenGLVertexArrayObject;
+    EmptyVertexArray->create();
+
+    CreateImpostorProgram();
+
+    GeometryChanged = true;
+    // The tessellation support is known now, so the mode may need a mesh
+    DirtyFlags |= GEOMETRY;
+    // The new program has default uniform values
+    UniformFlags = ALL;
+
+    InitializationTime = GetElapsedTime(start);
+    return true;
+}
+
+void EllipsoidRenderer::CreateTessellationProgram() {
+    // Needs GL 4.0 or ARB_tessellation_shader
+    if (!QOpenGLShader::hasOpenGLShaders(
+            QOpenGLShader::TessellationControl)) {
+        qDebug() << "Tessellation shaders aren't supported, the tessellated"
+                    " mode draws the indexed mesh";
+        return;
+    }
+
+    TessellationProgram = new QOpenGLShaderProgram;
+    const ShaderCache::ShaderList shaders = {
+        {QOpenGLShader::Vertex, TESSELLATION_VERTEX_SHADER},
+        {QOpenGLShader::TessellationControl, TESSELLATION_CONTROL_SHADER},
+        {QOpenGLShader::TessellationEvaluation,
+         TESSELLATION_EVALUATION_SHADER},
+        {QOpenGLShader::Fragment, FRAGMENT_SHADER}};
+
+    if (!Shaders.Link(*TessellationProgram, shaders)) {
+        qDebug() << TessellationProgram->log();
+        delete TessellationProgram;
+        TessellationProgram = nullptr;
+        return;
+    }
+    BindLightingBlock(TessellationProgram);
+    glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &MaxTessLevel);
+}
+
+void EllipsoidRenderer::CreateImpostorProgram() {
+    ImpostorProgram = new QOpenGLShaderProgram;
+    const ShaderCache::ShaderList shaders = {
+        {QOpenGLShader::Vertex, IMPOSTOR_VERTEX_SHADER},
+        {QOpenGLShader::Fragment, IMPOSTOR_FRAGMENT_SHADER}};
+    // Unused attributes have location -1 and aren't bound
+    const ShaderCache::AttributeList attributes = {
+        {INSTANCE_OFFSET, InstanceOffsetAttribute},
+        {INSTANCE_SCALE, InstanceScaleAttribute},
+        {INSTANCE_ROTATION, InstanceRotationAttribute},
+        {INSTANCE_COLOR, InstanceColorAttribute}};
+
+    if (!Shaders.Link(*ImpostorProgram, shaders, attributes)) {
+        qDebug() << ImpostorProgram->log();
+        qDebug() << "The impostor program isn't linked, the impostor mode"
+                    " draws the instanced mesh";
+        delete ImpostorProgram;
+        ImpostorProgram = nullptr;
+        return;
+    }
+    BindLightingBlock(ImpostorProgram);
+}
+
+void EllipsoidRenderer::BindLightingBlock(QOpenGLShaderProgram* program) {
+    const auto programId = program->programId();
+    const auto lightingIndex =
+        glGetUniformBlockIndex(programId, LIGHTING_BLOCK);
+    if (lightingIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(programId, lightingIndex, LIGHTING_BINDING);
+    }
+}
+
+void EllipsoidRenderer::ResolveUniforms() {
+    // Names missing in the program get -1, and setting them does nothing
+    RotateMatrixUniform = ShaderProgram->uniformLocation(ROTATE_MATRIX);
+    TransformMatrixUniform = ShaderProgram->uniformLocation(TRANSFORM_MATRIX);
+    TimeUniform = ShaderProgram->uniformLocation(TIME);
+    ProceduralUniform = ShaderProgram->uniformLocation(PROCEDURAL);
+    AxesUniform = ShaderProgram->uniformLocation(AXES);
+    SegmentCountUniform = ShaderProgram->uniformLocation(SEGMENT_COUNT);
+    RingCountUniform = ShaderProgram->uniformLocation(RING_COUNT);
+    RingStartUniform = ShaderProgram->uniformLocation(RING_START);
+    RingStepUniform = ShaderProgram->uniformLocation(RING_STEP);
+    HeightRangeUniform = ShaderProgram->uniformLocation(HEIGHT_RANGE);
+    PatchSegmentsUniform = ShaderProgram->uniformLocation(PATCH_SEGMENTS);
+    PatchBandsUniform = ShaderProgram->uniformLocation(PATCH_BANDS);
+    ViewportSizeUniform = ShaderProgram->uniformLocation(VIEWPORT_SIZE);
+    PixelErrorUniform = ShaderProgram->uniformLocation(PIXEL_ERROR);
+    MaxTessLevelUniform = ShaderProgram->uniformLocation(MAX_TESS_LEVEL);
+}
+
+void EllipsoidRenderer::CleanUp() {
+    // Initialize() may have failed before creating any of them
+    if (VertexArray != nullptr) {
+        VertexArray->destroy();
+    }
+    if (EmptyVertexArray != nullptr) {
+        EmptyVertexArray->destroy();
+    }
+    for (auto buffer : {Buffer, IndexBuffer, InstanceBuffer}) {
+        if (buffer != nullptr) {
+            buffer->destroy();
+        }
+    }
+    if (LightingBuffer != 0) {
+        glDeleteBuffers(1, &LightingBuffer);
+        LightingBuffer = 0;
+    }
+    if (HasTimerQueries) {
+        for (auto&& queries : TimerQueries) {
+            glDeleteQueries(queries.size(), queries.data());
+        }
+        glDeleteQueries(PrimitiveQueries.size(), PrimitiveQueries.data());
+        HasTimerQueries = false;
+    }
+
+    delete VertexArray;
+    delete EmptyVertexArray;
+    delete Buffer;
+    delete IndexBuffer;
+    delete InstanceBuffer;
+    delete MeshProgram;
+    delete TessellationProgram;
+    delete ImpostorProgram;
+    VertexArray = nullptr;
+    EmptyVertexArray = nullptr;
+    Buffer = nullptr;
+    IndexBuffer = nullptr;
+    InstanceBuffer = nullptr;
+    MeshProgram = nullptr;
+    TessellationProgram = nullptr;
+    ImpostorProgram = nullptr;
+    ShaderProgram = nullptr;
+}
+
+void EllipsoidRenderer::Update(int width, int height) {
+    if (width != Width || height != Height) {
+        Width = width;
+        Height = height;
+        DirtyFlags |= TRANSFORM;
+    }
+
+    Statistics.GenerationTime = 0;
+    // Shader modes have no mesh to build
+    if (Options.AsyncGeneration && GeneratesMesh() && !Builder) {
+        Builder = std::make_unique<AsyncMeshBuilder>(EllipsoidLayer,
+                                                     MeshReadyCallback);
+    }
+    if (Builder) {
+        AdoptBuiltMesh();
+    }
+
+    if (!(DirtyFlags & (GEOMETRY | TRANSFORM))) {
+        UniformFlags |= DirtyFlags;
+        DirtyFlags = CLEAN;
+        return;
+    }
+
+    const auto start = Clock::now();
+
+    // Zooming may move the ellipsoid to another level of detail
+    if (Options.AdaptiveLod && (DirtyFlags & TRANSFORM) &&
+        Lod.Select(GetPixelsPerUnit()) != Level) {
+        DirtyFlags |= GEOMETRY;
+    }
+    if (DirtyFlags & GEOMETRY) {
+        Level = Options.AdaptiveLod ? Lod.GetLevel()
+                                    : LodLevel{VertexCount, SurfaceCount};
+        EllipsoidLayer.SetVertexCount(Level.VertexCount);
+        EllipsoidLayer.SetSurfaceCount(Level.SurfaceCount);
+    }
+
+    const Mat4x4 rotateMatrix = GenerateRotateMatrix(RotateType::OX) *
+                                GenerateRotateMatrix(RotateType::OY) *
+                                GenerateRotateMatrix(RotateType::OZ);
+    const Mat4x4 scaleMatrix = GenerateScaleMatrix(width, height);
+
+    if (Options.Mode != RenderMode::CPU_TRANSFORM) {
+        // Rotation is done by the vertex shader, so the mesh depends
+        // on tessellation params only. Shader modes build it themselves.
+        if ((DirtyFlags & GEOMETRY) && GeneratesMesh()) {
+            PrepareMesh(std::nullopt);
+        }
+        if ((DirtyFlags & GEOMETRY) && UsesInstances()) {
+            GenerateInstanceGrid(Options.InstanceCount, BoundingRadius,
+                                 Instances);
+            GeometryChanged = true;
+        }
+        RotateMatrix = rotateMatrix;
+        TransformMatrix = scaleMatrix * GenerateDepthProjectionMatrix();
+    } else {
+        // Culling depends on the view, so any change rebuilds the layers
+        // unless this view is cached
+        PrepareMesh(rotateMatrix);
+        RotateMatrix = Mat4x4::Identity();
+        TransformMatrix = scaleMatrix * GenerateProjectionMatrix();
+    }
+
+    UniformFlags |= DirtyFlags;
+    DirtyFlags = CLEAN;
+    // The asynchronous mode reports the build time of the adopted mesh
+    if (!Builder) {
+        Statistics.GenerationTime = GetElapsedTime(start);
+    }
+}
+
+void EllipsoidRenderer::Render() {
+    // Shader modes have their own programs, all uniforms are set again
+    // after a switch
+    auto program = MeshProgram;
+    if (IsTessellated()) {
+        program = TessellationProgram;
+    } else if (IsImpostor()) {
+        program = ImpostorProgram;
+    }
+    if (program != ShaderProgram) {
+        ShaderProgram = program;
+        ResolveUniforms();
+        UniformFlags = ALL;
+    }
+
+    if (!ShaderProgram->bind()) {
+        qDebug() << "Cannot bind program";
+        return;
+    }
+
+    // Uniforms keep their values between frames, only changed ones are set
+    if (UniformFlags & (GEOMETRY | TRANSFORM)) {
+        SetUniformMatrix(RotateMatrixUniform, RotateMatrix);
+        SetUniformMatrix(TransformMatrixUniform, TransformMatrix);
+    }
+    if (UniformFlags & GEOMETRY) {
+        SetProceduralUniforms();
+    }
+    if (IsTessellated() && (UniformFlags & (GEOMETRY | TRANSFORM))) {
+        SetTessellationUniforms();
+    }
+    if (IsImpostor() && (UniformFlags & GEOMETRY)) {
+        SetImpostorUniforms();
+    }
+    if (UniformFlags & LIGHTING) {
+        UploadLighting();
+    }
+    if (UniformFlags & ANIMATION) {
+        ShaderProgram->setUniformValue(TimeUniform, Time);
+    }
+    UniformFlags = CLEAN;
+
+    // Results of earlier frames are taken first, so their query sets can
+    // be reused. A set still in flight skips timing of this frame.
+    ReadTimerQueries();
+    TimingFrame = HasTimerQueries && !TimerPending[TimerFrame];
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    glShadeModel(GL_SMOOTH);
+
+    // GPU modes upload the closed mesh and let GL cull back faces;
+    // the CPU mode has already dropped them
+    if (Options.Mode != RenderMode::CPU_TRANSFORM) {
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glFrontFace(GL_CCW);
+        glCullFace(GL_BACK);
+    } else {
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+    }
+
+    // Frames without geometry changes reuse the uploaded data
+    auto start = Clock::now();
+    BeginTimer(GPU_UPLOAD);
+    if (GeometryChanged && (GeneratesMesh() || UsesInstances())) {
+        UploadGeometry();
+        GeometryChanged = false;
+    }
+    EndTimer();
+    Statistics.UploadTime = GetElapsedTime(start);
+
+    start = Clock::now();
+    BeginTimer(GPU_DRAW);
+    Statistics.DrawCallCount = 0;
+    Statistics.InstanceCount = 1;
+    const auto vertexArray = GeneratesMesh() || UsesInstances()
+                                 ? VertexArray
+                                 : EmptyVertexArray;
+    vertexArray->bind();
+    if (vertexArray == EmptyVertexArray && VertexLayoutChanged) {
+        // Instance attributes are read as constants that keep the mesh
+        SetupInstanceAttributes();
+        VertexLayoutChanged = false;
+    }
+    const auto indexType =
+        DrawMesh->HasShortIndices() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    if (IsInstanced()) {
+        // One call draws every instance of the shared mesh
+        glDrawElementsInstanced(GL_TRIANGLES, DrawMesh->GetIndexCount(),
+                                indexType, nullptr, Instances.size());
+        Statistics.DrawCallCount++;
+        Statistics.InstanceCount = Instances.size();
+    } else if (IsImpostor()) {
+        // One bounding quad per ellipsoid, fragments find the surface
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, QUAD_VERTEX_COUNT,
+                              Instances.size());
+        Statistics.DrawCallCount++;
+        Statistics.InstanceCount = Instances.size();
+    } else if (IsTessellated()) {
+        // Every patch is refined from its corners by the tessellator,
+        // only the GPU knows how many triangles it makes
+        if (TimingFrame) {
+            glBeginQuery(GL_PRIMITIVES_GENERATED,
+                         PrimitiveQueries[TimerFrame]);
+        }
+        glPatchParameteri(GL_PATCH_VERTICES, PATCH_VERTEX_COUNT);
+        glDrawArrays(GL_PATCHES, 0,
+                     PATCH_VERTEX_COUNT * PATCH_SEGMENT_COUNT *
+                         (PATCH_BAND_COUNT + 2));
+        if (TimingFrame) {
+            glEndQuery(GL_PRIMITIVES_GENERATED);
+            PrimitivePending[TimerFrame] = true;
+        }
+        Statistics.DrawCallCount++;
+    } else if (IsProcedural()) {
+        // Nothing is read from buffers, gl_VertexID is the only input
+        glDrawArrays(GL_TRIANGLES, 0, GetProceduralVertexCount());
+        Statistics.DrawCallCount++;
+    } else if (IsIndexed()) {
+        // The tessellated mode without tessellation support comes here
+        glDrawElements(GL_TRIANGLES, DrawMesh->GetIndexCount(), indexType,
+                       nullptr);
+        Statistics.DrawCallCount++;
+    } else {
+        // Layers are stored back to back, so one range covers them all
+        glDrawArrays(GL_TRIANGLES, 0, UploadedVertexCount);
+        Statistics.DrawCallCount++;
+    }
+
+    EndTimer();
+    vertexArray->release();
+    ShaderProgram->release();
+    Statistics.DrawTime = GetElapsedTime(start);
+
+    if (TimingFrame) {
+        TimerPending[TimerFrame] = true;
+        TimerFrame = (TimerFrame + 1) % TIMER_FRAME_COUNT;
+    }
+    if (IsTessellated()) {
+        // Counted by the query of an earlier frame
+        Statistics.TriangleCount = TessellatedTriangleCount;
+    } else if (IsImpostor()) {
+        Statistics.TriangleCount = 2 * Instances.size();
+    } else if (IsProcedural()) {
+        Statistics.TriangleCount = GetProceduralVertexCount() / 3;
+    } else if (IsIndexed()) {
+        Statistics.TriangleCount =
+            DrawMesh->GetIndexCount() / 3 * Statistics.InstanceCount;
+    } else {
+        Statistics.TriangleCount = UploadedVertexCount / 3;
+    }
+    AddAverages();
+}
+
+EllipsoidRenderer::FrameStatistics EllipsoidRenderer::GetAverageStatistics()
+    const {
+    FrameStatistics average;
+    average.GenerationTime = GenerationAverage.Get();
+    average.UploadTime = UploadAverage.Get();
+    average.DrawTime = DrawAverage.Get();
+    average.GpuUploadTime =
+        GpuUploadAverage.GetCount() > 0 ? GpuUploadAverage.Get() : -1;
+    average.GpuDrawTime =
+        GpuDrawAverage.GetCount() > 0 ? GpuDrawAverage.Get() : -1;
+    average.DrawCallCount = Statistics.DrawCallCount;
+    average.InstanceCount = Statistics.InstanceCount;
+    average.TriangleCount =
+        static_cast<SizeType>(std::lround(TriangleAverage.Get()));
+    return average;
+}
+
+void EllipsoidRenderer::SetRenderOptions(const RenderOptions& options) {
+    Options = options;
+    Lod.SetPixelError(options.LodPixelError);
+
+    // Results of the old builder may not match the new mode, so it's
+    // dropped together with pointers to its buffers and cache entries
+    Builder.reset();
+    DrawArena = &Arenas[FrontArena];
+    DrawMesh = &Mesh;
+    CachedMeshes.SetCapacity(options.MeshCacheBytes);
+    if (!UseMeshCache()) {
+        CachedMeshes.Clear();
+    }
+    // Unknown until a query of the new mode finishes
+    TessellatedTriangleCount = 0;
+
+    // Force mesh regeneration and attribute setup for the new mode
+    DirtyFlags |= GEOMETRY | TRANSFORM;
+    VertexLayoutChanged = true;
+}
+
+void EllipsoidRenderer::SetMeshReadyCallback(std::function<void()> callback) {
+    MeshReadyCallback = std::move(callback);
+    // Recreated with the new callback by the next Update
+    Builder.reset();
+    DrawArena = &Arenas[FrontArena];
+    DrawMesh = &Mesh;
+    DirtyFlags |= GEOMETRY;
+}
+
+void EllipsoidRenderer::SetScaleFactor(FloatType scaleFactor) {
+    ScaleFactor = scaleFactor;
+    DirtyFlags |= TRANSFORM;
+}
+
+void EllipsoidRenderer::SetAngle(RotateType rotateType, FloatType angle) {
+    switch (rotateType) {
+        case RotateType::OX:
+            AngleOX = angle;
+            break;
+        case RotateType::OY:
+            AngleOY = angle;
+            break;
+        case RotateType::OZ:
+            AngleOZ = angle;
+            break;
+    }
+    DirtyFlags |= TRANSFORM;
+}
+
+void EllipsoidRenderer::SetAmbientCoeff(FloatType ambientCoeff) {
+    AmbientCoeff = ambientCoeff;
+    DirtyFlags |= LIGHTING;
+}
+
+void EllipsoidRenderer::SetSpecularCoeff(FloatType specularCoeff) {
+    SpecularCoeff = specularCoeff;
+    DirtyFlags |= LIGHTING;
+}
+
+void EllipsoidRenderer::SetDiffuseCoeff(FloatType diffuseCoeff) {
+    DiffuseCoeff = diffuseCoeff;
+    DirtyFlags |= LIGHTING;
+}
+
+void EllipsoidRenderer::SetTime(FloatType time) {
+    Time = time;
+    DirtyFlags |= ANIMATION;
+}
+
+void EllipsoidRenderer::SetVertexCount(SizeType count) {
+    if (count != VertexCount) {
+        VertexCount = count;
+        DirtyFlags |= GEOMETRY;
+    }
+}
+
+void EllipsoidRenderer::SetSurfaceCount(SizeType count) {
+    if (count != SurfaceCount) {
+        SurfaceCount = count;
+        DirtyFlags |= GEOMETRY;
+    }
+}
+
+void EllipsoidRenderer::PrepareMesh(
+    const std::optional<Mat4x4>& rotateMatrix) {
+    ++MeshVersion;
+    const auto cacheable = CanCacheMesh(rotateMatrix);
+    const auto key = MeshKey(EllipsoidLayer, Level.VertexCount,
+                             Level.SurfaceCount, IsIndexed());
+    if (cacheable && FindCachedMesh(key)) {
+        DrawnVersion = MeshVersion;
+        GeometryChanged = true;
+        return;
+    }
+    if (Builder) {
+        // The old mesh is drawn until the new one is published
+        RequestMesh(rotateMatrix);
+        return;
+    }
+
+    if (cacheable) {
+        // The spare keeps the storage of an evicted mesh
+        auto mesh = CachedMeshes.TakeSpare();
+        if (IsIndexed()) {
+            mesh.Mesh = EllipsoidLayer.GenerateIndexedMesh();
+            mesh.Arena = VertexArena();
+        } else {
+            mesh.Mesh = IndexedMesh();
+            EllipsoidLayer.GenerateMesh(mesh.Arena);
+        }
+        StoreMesh(key, std::move(mesh));
+    } else if (IsIndexed()) {
+        Mesh = EllipsoidLayer.GenerateIndexedMesh();
+        DrawMesh = &Mesh;
+    } else {
+        auto& arena = SwapArenas();
+        if (rotateMatrix) {
+            EllipsoidLayer.GenerateVertices(*rotateMatrix, arena);
+        } else {
+            EllipsoidLayer.GenerateMesh(arena);
+        }
+        DrawArena = &arena;
+    }
+    DrawnVersion = MeshVersion;
+    GeometryChanged = true;
+}
+
+bool EllipsoidRenderer::FindCachedMesh(const MeshKey& key) {
+    if (!UseMeshCache()) {
+        return false;
+    }
+
+    const auto found = CachedMeshes.Find(key);
+    if (found == nullptr) {
+        return false;
+    }
+    if (key.Indexed) {
+        DrawMesh = &found->Mesh;
+    } else {
+        DrawArena = &found->Arena;
+    }
+    return true;
+}
+
+void EllipsoidRenderer::StoreMesh(const MeshKey& key, CachedMesh&& mesh) {
+    const auto bytes = mesh.GetByteSize();
+    const auto& stored = CachedMeshes.Insert(key, std::move(mesh), bytes);
+    if (key.Indexed) {
+        DrawMesh = &stored.Mesh;
+    } else {
+        DrawArena = &stored.Arena;
+    }
+}
+
+void EllipsoidRenderer::RequestMesh(
+    const std::optional<Mat4x4>& rotateMatrix) {
+    AsyncMeshBuilder::MeshRequest request;
+    request.VertexCount = Level.VertexCount;
+    request.SurfaceCount = Level.SurfaceCount;
+    request.Indexed = IsIndexed();
+    request.RotateMatrix = rotateMatrix;
+    request.Id = MeshVersion;
+    Builder->Request(request);
+}
+
+void EllipsoidRenderer::AdoptBuiltMesh() {
+    // Taking a new result returns the previous one to the builder, so
+    // pointers to it are replaced right away. That happens only without
+    // the cache, and then results come in request order and are drawn.
+    const auto result = Builder->Take();
+    if (result == nullptr) {
+        return;
+    }
+    const auto& request = result->Request;
+    if (request.Id < DrawnVersion) {
+        return;
+    }
+
+    if (CanCacheMesh(request.RotateMatrix)) {
+        // Copies reuse the capacity of the spare
+        auto mesh = CachedMeshes.TakeSpare();
+        if (request.Indexed) {
+            mesh.Mesh = result->Mesh;
+            mesh.Arena = VertexArena();
+        } else {
+            mesh.Mesh = IndexedMesh();
+            mesh.Arena = result->Arena;
+        }
+        StoreMesh(MeshKey(EllipsoidLayer, request.VertexCount,
+                          request.SurfaceCount, request.Indexed),
+                  std::move(mesh));
+    } else if (request.Indexed) {
+        DrawMesh = &result->Mesh;
+    } else {
+        DrawArena = &result->Arena;
+    }
+    DrawnVersion = request.Id;
+    GeometryChanged = true;
+    Statistics.GenerationTime = result->BuildTime;
+}
+
+float EllipsoidRenderer::GetPixelsPerUnit() const {
+    // The scale matrix maps x to x * ScaleFactor * DEFAULT_WIDTH / width
+    // in NDC, and NDC covers width / 2 pixels, so the window size cancels
+    // out and the on-screen size depends on ScaleFactor only
+    const auto defaultSize =
+        std::min(IMAGE_DEFAULT_SIZE.width(), IMAGE_DEFAULT_SIZE.height());
+    return ScaleFactor * defaultSize / 2;
+}
+
+bool EllipsoidRenderer::IsIndexed() const {
+    return Options.Mode == RenderMode::INDEXED || IsInstanced() ||
+           (Options.Mode == RenderMode::TESSELLATED && !IsTessellated());
+}
+
+bool EllipsoidRenderer::IsInstanced() const {
+    return Options.Mode == RenderMode::INSTANCED ||
+           (Options.Mode == RenderMode::IMPOSTOR && !IsImpostor());
+}
+
+bool EllipsoidRenderer::UsesInstances() const {
+    return IsInstanced() || IsImpostor();
+}
+
+bool EllipsoidRenderer::GeneratesMesh() const {
+    return !IsProcedural() && !IsTessellated() && !IsImpostor();
+}
+
+bool EllipsoidRenderer::IsTessellated() const {
+    return Options.Mode == RenderMode::TESSELLATED &&
+           TessellationProgram != nullptr;
+}
+
+bool EllipsoidRenderer::IsImpostor() const {
+    return Options.Mode == RenderMode::IMPOSTOR && ImpostorProgram != nullptr;
+}
+
+SizeType EllipsoidRenderer::GetProceduralVertexCount() const {
+    // Two triangles per side segment between rings, one per cap segment
+    const auto ringCount = EllipsoidLayer.GetRingHeights().size();
+    return 6 * Level.VertexCount * (ringCount - 1) + 6 * Level.VertexCount;
+}
+
+VertexArena& EllipsoidRenderer::SwapArenas() {
+    FrontArena = 1 - FrontArena;
+    return Arenas[FrontArena];
+}
+
+double EllipsoidRenderer::GetElapsedTime(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+}
+
+void EllipsoidRenderer::UploadGeometry() {
+    VertexArray->bind();
+    Buffer->bind();
+
+    if (VertexLayoutChanged) {
+        SetupVertexAttributes();
+    }
+
+    if (UsesInstances()) {
+        const auto instanceBytes = Instances.size() * sizeof(EllipsoidInstance);
+        InstanceBuffer->bind();
+        ReserveBuffer(InstanceBuffer, InstanceBufferCapacity, instanceBytes);
+        InstanceBuffer->write(0, Instances.data(), instanceBytes);
+        Buffer->bind();
+    }
+    // Impostors need the instances only
+    if (!GeneratesMesh()) {
+        VertexArray->release();
+        Buffer->release();
+        return;
+    }
+
+    if (IsIndexed()) {
+        const auto indexBytes =
+            DrawMesh->GetIndexCount() * DrawMesh->GetIndexSize();
+        IndexBuffer->bind();
+        ReserveBuffer(IndexBuffer, IndexBufferCapacity, indexBytes);
+        IndexBuffer->write(0, DrawMesh->GetIndexData(), indexBytes);
+    }
+
+    // Layers are compacted in the arena, so vertices are one range
+    const auto vertices =
+        IsIndexed() ? DrawMesh->GetVertices().data() : DrawArena->GetData();
+    UploadedVertexCount = IsIndexed() ? DrawMesh->GetVertices().size()
+                                      : DrawArena->GetVertexCount();
+    const auto stride = GetVertexLayout().Stride;
+    ReserveBuffer(Buffer, VertexBufferCapacity, UploadedVertexCount * stride);
+
+    if (Options.PackedVertices) {
+        // Keeps its capacity, so repacking doesn't allocate either
+        PackedVertices.assign(vertices, vertices + UploadedVertexCount);
+        Buffer->write(0, PackedVertices.data(),
+                      PackedVertices.size() * sizeof(PackedVertex));
+    } else {
+        Buffer->write(0, vertices, UploadedVertexCount * sizeof(Vertex));
+    }
+
+    VertexArray->release();
+    Buffer->release();
+}
+
+VertexLayout EllipsoidRenderer::GetVertexLayout() const {
+    return Options.PackedVertices ? PackedVertex::GetLayout()
+                                  : Vertex::GetLayout();
+}
+
+void EllipsoidRenderer::SetupVertexAttributes() {
+    const auto layout = GetVertexLayout();
+    for (auto&& attribute : layout.Attributes) {
+        const auto location =
+            attribute.AttributeSemantic == VertexAttribute::Semantic::POSITION
+                ? PositionAttribute
+                : ColorAttribute;
+        const auto type =
+            attribute.Type == VertexAttribute::ComponentType::FLOAT
+                ? GL_FLOAT
+                : GL_INT_2_10_10_10_REV;
+
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(
+            location, attribute.TupleSize, type,
+            attribute.Normalized ? GL_TRUE : GL_FALSE,
+            layout.Stride,
+            reinterpret_cast<const void*>(
+                static_cast<std::intptr_t>(attribute.Offset)));
+    }
+    SetupInstanceAttributes();
+    VertexLayoutChanged = false;
+}
+
+void EllipsoidRenderer::SetupInstanceAttributes() {
+    struct InstanceAttribute {
+        int Location;
+        GLint TupleSize;
+        std::size_t Offset;
+        // Value of the disabled array, leaves the mesh as is
+        GLfloat Default[4];
+    };
+    const InstanceAttribute attributes[] = {
+        {InstanceOffsetAttribute, 3, offsetof(EllipsoidInstance, Offset),
+         {0, 0, 0, 1}},
+        {InstanceScaleAttribute, 3, offsetof(EllipsoidInstance, Scale),
+         {1, 1, 1, 1}},
+        {InstanceRotationAttribute, 4, offsetof(EllipsoidInstance, Rotation),
+         {0, 0, 0, 1}},
+        {InstanceColorAttribute, 4, offsetof(EllipsoidInstance, Color),
+         {0, 0, 0, 0}}};
+
+    const auto instanced = UsesInstances();
+    if (instanced) {
+        InstanceBuffer->bind();
+    }
+    for (auto&& attribute : attributes) {
+        if (attribute.Location < 0) {
+            continue;
+        }
+        if (instanced) {
+            glEnableVertexAttribArray(attribute.Location);
+            glVertexAttribPointer(
+                attribute.Location, attribute.TupleSize, GL_FLOAT, GL_FALSE,
+                sizeof(EllipsoidInstance),
+                reinterpret_cast<const void*>(
+                    static_cast<std::intptr_t>(attribute.Offset)));
+            // Advance once per instance instead of once per vertex
+            glVertexAttribDivisor(attribute.Location, 1);
+        } else {
+            glDisableVertexAttribArray(attribute.Location);
+            glVertexAttrib4fv(attribute.Location, attribute.Default);
+        }
+    }
+    if (instanced) {
+        Buffer->bind();
+    }
+}
+
+void EllipsoidRenderer::ReserveBuffer(QOpenGLBuffer* buffer,
+                                      SizeType& capacity,
+                                      SizeType bytes) {
+    if (bytes > capacity) {
+        capacity = std::max(bytes, 2 * capacity);
+    }
+
+    // Storage is orphaned on every update, so the following writes
+    // don't wait for draws that still use the previous data
+    buffer->allocate(capacity);
+}
+
+Mat4x4 EllipsoidRenderer::GenerateScaleMatrix(int width, int height) const {
+    const auto DEFAULT_WIDTH = IMAGE_DEFAULT_SIZE.width();
+    const auto DEFAULT_HEIGHT = IMAGE_DEFAULT_SIZE.height();
+
+    auto xScaleFactor = 1.0f * DEFAULT_WIDTH / width;
+    auto yScaleFactor = 1.0f * DEFAULT_HEIGHT / height;
+
+    GLfloat matrixData[] = {
+        xScaleFactor * ScaleFactor,
+        0.0f,
+        0.0f,
+        0.0f,  // first line
+        0.0f,
+        yScaleFactor * ScaleFactor,
+        0.0f,
+        0.0f,  // second line
+        0.0f,
+        0.0f,
+        1.0f,
+        0.0f,  // third line
+        0.0f,
+        0.0f,
+        0.0f,
+        1.0f  // fourth line
+    };
+
+    return Map4x4(matrixData);
+}
+
+Mat4x4 EllipsoidRenderer::GenerateRotateMatrix(RotateType rotateType) const {
+    FloatType angle = 0;
+    switch (rotateType) {
+        case RotateType::OX:
+            angle = AngleOX;
+            break;
+        case RotateType::OY:
+            angle = AngleOY;
+            break;
+        case RotateType::OZ:
+            angle = AngleOZ;
+            break;
+    }
+    return GenerateRotateMatrixByAngle(rotateType, angle);
+}
+
+Mat4x4 EllipsoidRenderer::GenerateRotateMatrixByAngle(RotateType rotateType,
+                                                      FloatType angle) {
+    FloatType rotateOXData[] = {
+        1.0f,
+        0,
+        0,
+        0,  // first line
+        0,
+        std::cos(angle),
+        std::sin(angle),
+        0,  // second line
+        0,
+        -std::sin(angle),
+        std::cos(angle),
+        0,  // third line
+        0,
+        0,
+        0,
+        1.0f  // fourth line
+    };
+
+    FloatType rotateOYData[] = {
+        std::cos(angle),
+        0,
+        -std::sin(angle),
+        0,  // fist line
+        0,
+        1.0f,
+        0,
+        0,  // second line
+        std::sin(angle),
+        0,
+        std::cos(angle),
+        0,  // third line
+        0,
+        0,
+        0,
+        1.0f  // fourth line
+    };
+
+    FloatType rotateOZData[] = {
+        std::cos(angle),
+        std::sin(angle),
+        0,
+        0,  // first line
+        -std::sin(angle),
+        std::cos(angle),
+        0,
+        0,  // second line
+        0,
+        0,
+        1.0f,
+        0,  // third line
+        0,
+        0,
+        0,
+        1.0f  // fourth line
+    };
+
+    FloatType* matrixData = nullptr;
+    switch (rotateType) {
+        case RotateType::OX:
+            matrixData = rotateOXData;
+            break;
+        case RotateType::OY:
+            matrixData = rotateOYData;
+            break;
+        case RotateType::OZ:
+            matrixData = rotateOZData;
+            break;
+    }
+
+    return Map4x4(matrixData);
+}
+
+Mat4x4 EllipsoidRenderer::GenerateProjectionMatrix() {
+    FloatType matrixData[] = {
+        1, 0, 0, 0,  // first line
+        0, 1, 0, 0,  // second line
+        0, 0, 0, 0,  // third line
+        0, 0, 0, 1   // fourth line
+    };
+
+    return Map4x4(matrixData);
+}
+
+Mat4x4 EllipsoidRenderer::GenerateDepthProjectionMatrix() {
+    // Keeps depth for the depth test: the observer looks from +OZ
+    FloatType matrixData[] = {
+        1, 0, 0,            0,  // first line
+        0, 1, 0,            0,  // second line
+        0, 0, -DEPTH_SCALE, 0,  // third line
+        0, 0, 0,            1   // fourth line
+    };
+
+    return Map4x4(matrixData);
+}
+
+void EllipsoidRenderer::CreateTimerQueries() {
+    // GL_TIME_ELAPSED is core since 3.3, OpenGL ES doesn't have it
+    const auto context = QOpenGLContext::currentContext();
+    HasTimerQueries = !context->isOpenGLES() &&
+                      (context->format().version() >= qMakePair(3, 3) ||
+                       context->hasExtension("GL_ARB_timer_query"));
+    TimerPending.fill(false);
+    PrimitivePending.fill(false);
+    TimerFrame = 0;
+
+    if (HasTimerQueries) {
+        for (auto&& queries : TimerQueries) {
+            glGenQueries(queries.size(), queries.data());
+        }
+        glGenQueries(PrimitiveQueries.size(), PrimitiveQueries.data());
+    } else {
+        qDebug() << "Timer queries aren't supported, no GPU times";
+    }
+}
+
+void EllipsoidRenderer::ReadTimerQueries() {
+    // Sets are scanned from the oldest one. They finish in order, so the
+    // first one without a result ends the scan.
+    for (SizeType i = 0; i < TIMER_FRAME_COUNT; i++) {
+        const auto frame = (TimerFrame + i) % TIMER_FRAME_COUNT;
+        if (!TimerPending[frame]) {
+            continue;
+        }
+
+        const auto& queries = TimerQueries[frame];
+        GLuint available = 0;
+        glGetQueryObjectuiv(queries[GPU_DRAW], GL_QUERY_RESULT_AVAILABLE,
+                            &available);
+        if (!available) {
+            break;
+        }
+
+        GLuint uploadTime = 0;
+        GLuint drawTime = 0;
+        glGetQueryObjectuiv(queries[GPU_UPLOAD], GL_QUERY_RESULT, &uploadTime);
+        glGetQueryObjectuiv(queries[GPU_DRAW], GL_QUERY_RESULT, &drawTime);
+        TimerPending[frame] = false;
+
+        // Nanoseconds to milliseconds
+        Statistics.GpuUploadTime = uploadTime / 1e6;
+        Statistics.GpuDrawTime = drawTime / 1e6;
+        GpuUploadAverage.Add(Statistics.GpuUploadTime);
+        GpuDrawAverage.Add(Statistics.GpuDrawTime);
+
+        if (PrimitivePending[frame]) {
+            GLuint triangles = 0;
+            glGetQueryObjectuiv(PrimitiveQueries[frame], GL_QUERY_RESULT,
+                                &triangles);
+            PrimitivePending[frame] = false;
+            TessellatedTriangleCount = triangles;
+            TriangleAverage.Add(triangles);
+        }
+    }
+}
+
+void EllipsoidRenderer::BeginTimer(GpuStage stage) {
+    if (TimingFrame) {
+        glBeginQuery(GL_TIME_ELAPSED, TimerQueries[TimerFrame][stage]);
+    }
+}
+
+void EllipsoidRenderer::EndTimer() {
+    if (TimingFrame) {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+}
+
+void EllipsoidRenderer::AddAverages() {
+    GenerationAverage.Add(Statistics.GenerationTime);
+    UploadAverage.Add(Statistics.UploadTime);
+    DrawAverage.Add(Statistics.DrawTime);
+    // Tessellated counts are added when their queries are read
+    if (!IsTessellated()) {
+        TriangleAverage.Add(Statistics.TriangleCount);
+    }
+}
+
+void EllipsoidRenderer::SetUniformMatrix(int location, const Mat4x4& matrix) {
+    // QMatrix4x4 reads row-major data while Eigen stores column-major, so
+    // transpose back to keep the `position * matrix` convention in shaders
+    ShaderProgram->setUniformValue(location,
+                                   QMatrix4x4(matrix.data()).transposed());
+}
+
+void EllipsoidRenderer::SetProceduralUniforms() {
+    ShaderProgram->setUniformValue(ProceduralUniform,
+                                   static_cast<GLint>(IsProcedural()));
+    if (!IsProcedural()) {
+        return;
+    }
+
+    // Heights are evenly spaced, so the first one and the step give them
+    const auto& heights = EllipsoidLayer.GetRingHeights();
+    const auto ringCount = static_cast<int>(heights.size());
+    const auto ringStep = (heights.back() - heights.front()) / (ringCount - 1);
+    ShaderProgram->setUniformValue(AxesUniform, EllipsoidLayer.GetA(),
+                                   EllipsoidLayer.GetB(),
+                                   EllipsoidLayer.GetC());
+    ShaderProgram->setUniformValue(SegmentCountUniform,
+                                   static_cast<int>(Level.VertexCount));
+    ShaderProgram->setUniformValue(RingCountUniform, ringCount);
+    ShaderProgram->setUniformValue(RingStartUniform, heights.front());
+    ShaderProgram->setUniformValue(RingStepUniform, ringStep);
+}
+
+void EllipsoidRenderer::SetTessellationUniforms() {
+    ShaderProgram->setUniformValue(AxesUniform, EllipsoidLayer.GetA(),
+                                   EllipsoidLayer.GetB(),
+                                   EllipsoidLayer.GetC());
+    ShaderProgram->setUniformValue(HeightRangeUniform, Ellipsoid::MIN_HEIGHT,
+                                   Ellipsoid::MAX_HEIGHT);
+    ShaderProgram->setUniformValue(PatchSegmentsUniform,
+                                   static_cast<GLint>(PATCH_SEGMENT_COUNT));
+    ShaderProgram->setUniformValue(PatchBandsUniform,
+                                   static_cast<GLint>(PATCH_BAND_COUNT));
+    ShaderProgram->setUniformValue(ViewportSizeUniform,
+                                   static_cast<GLfloat>(Width),
+                                   static_cast<GLfloat>(Height));
+    ShaderProgram->setUniformValue(PixelErrorUniform, Options.LodPixelError);
+    ShaderProgram->setUniformValue(MaxTessLevelUniform,
+                                   static_cast<GLfloat>(MaxTessLevel));
+}
+
+void EllipsoidRenderer::SetImpostorUniforms() {
+    ShaderProgram->setUniformValue(AxesUniform, EllipsoidLayer.GetA(),
+                                   EllipsoidLayer.GetB(),
+                                   EllipsoidLayer.GetC());
+    ShaderProgram->setUniformValue(HeightRangeUniform, Ellipsoid::MIN_HEIGHT,
+                                   Ellipsoid::MAX_HEIGHT);
+}
+
+void EllipsoidRenderer::UploadLighting() {
+    const LightingBlock block = {AmbientCoeff, DiffuseCoeff, SpecularCoeff, 0};
+
+    // The whole block is written with one call
+    glBindBuffer(GL_UNIFORM_BUFFER, LightingBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
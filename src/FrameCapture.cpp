@@ -0,0 +1,246 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <FrameCapture.hpp>
+#include <ThreadPool.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+
+namespace {
+
+const SizeType BYTES_PER_PIXEL = 4;
+// Wait for the GPU in slices, so a lost context doesn't hang forever
+const GLuint64 WAIT_SLICE_NS = 100000000;
+
+}  // namespace
+
+FrameCapture::FrameCapture(const CaptureOptions& options)
+    : Options{options}, NextIndex{0}, BusyWriters{0}, Stopped{false} {
+    for (auto i = 0UL; i < ThreadPool::GetDefaultThreadCount(); i++) {
+        Writers.emplace_back(&FrameCapture::WriterLoop, this);
+    }
+}
+
+FrameCapture::~FrameCapture() {
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Stopped = true;
+    }
+    // Writers drain the queue before they exit
+    QueueCondition.notify_all();
+    for (auto&& writer : Writers) {
+        writer.join();
+    }
+}
+
+bool FrameCapture::Initialize() {
+    initializeOpenGLFunctions();
+
+    if (!QDir().mkpath(Options.Directory)) {
+        qWarning() << "Cannot create capture directory" << Options.Directory;
+        return false;
+    }
+
+    for (auto&& buffer : Buffers) {
+        glGenBuffers(1, &buffer.Buffer);
+    }
+    return true;
+}
+
+void FrameCapture::CleanUp() {
+    Finish();
+    for (auto&& buffer : Buffers) {
+        glDeleteBuffers(1, &buffer.Buffer);
+        buffer = PixelBuffer();
+    }
+}
+
+void FrameCapture::Capture(int width, int height) {
+    if (NextIndex == 0) {
+        StartTime = Clock::now();
+    }
+
+    // The frame read RING_SIZE captures ago has been mapped already
+    auto& buffer = Buffers[NextIndex % RING_SIZE];
+    const auto bytes = static_cast<SizeType>(width) * height * BYTES_PER_PIXEL;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.Buffer);
+    if (bytes > buffer.Capacity) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        buffer.Capacity = bytes;
+    }
+    // Returns at once, the copy is done by the GPU after the frame
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    buffer.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    buffer.Index = NextIndex;
+    buffer.Width = width;
+    buffer.Height = height;
+
+    NextIndex++;
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Statistics.Captured++;
+    }
+
+    if (NextIndex > READ_LATENCY) {
+        ReadBuffer(Buffers[(NextIndex - 1 - READ_LATENCY) % RING_SIZE]);
+    }
+}
+
+void FrameCapture::Finish() {
+    // Pending buffers in capture order
+    for (auto index = NextIndex - std::min(NextIndex, READ_LATENCY);
+         index < NextIndex; index++) {
+        auto& buffer = Buffers[index % RING_SIZE];
+        if (buffer.Fence) {
+            ReadBuffer(buffer);
+        }
+    }
+    WaitForWriters();
+}
+
+void FrameCapture::WaitForWriters() {
+    std::unique_lock<std::mutex> lock(Mutex);
+    DoneCondition.wait(lock,
+                       [this]() { return Queue.empty() && BusyWriters == 0; });
+}
+
+FrameCapture::Counters FrameCapture::GetCounters() const {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Statistics;
+}
+
+double FrameCapture::GetCaptureRate() const {
+    std::lock_guard<std::mutex> lock(Mutex);
+    const auto seconds =
+        std::chrono::duration<double>(LastWriteTime - StartTime).count();
+    return seconds > 0 ? Statistics.Written / seconds : 0;
+}
+
+void FrameCapture::ReadBuffer(PixelBuffer& buffer) {
+    auto status = glClientWaitSync(buffer.Fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Statistics.GpuStalls++;
+    }
+    while (status == GL_TIMEOUT_EXPIRED) {
+        status = glClientWaitSync(buffer.Fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                  WAIT_SLICE_NS);
+    }
+    glDeleteSync(buffer.Fence);
+    buffer.Fence = nullptr;
+
+    Frame frame;
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        if (Queue.size() >= MAX_QUEUED_FRAMES) {
+            Statistics.WriterStalls++;
+            DoneCondition.wait(
+                lock, [this]() { return Queue.size() < MAX_QUEUED_FRAMES; });
+        }
+        if (!FreePixels.empty()) {
+            frame.Pixels = std::move(FreePixels.back());
+            FreePixels.pop_back();
+        }
+    }
+
+    const auto bytes =
+        static_cast<SizeType>(buffer.Width) * buffer.Height * BYTES_PER_PIXEL;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.Buffer);
+    const auto data =
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+    if (data == nullptr || status == GL_WAIT_FAILED) {
+        qWarning() << "Cannot read captured frame" << buffer.Index;
+        if (data != nullptr) {
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return;
+    }
+    frame.Pixels.resize(bytes);
+    std::memcpy(frame.Pixels.data(), data, bytes);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    frame.Index = buffer.Index;
+    frame.Width = buffer.Width;
+    frame.Height = buffer.Height;
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Queue.push_back(std::move(frame));
+    }
+    QueueCondition.notify_one();
+}
+
+void FrameCapture::WriterLoop() {
+    std::unique_lock<std::mutex> lock(Mutex);
+    while (true) {
+        QueueCondition.wait(lock,
+                            [this]() { return Stopped || !Queue.empty(); });
+        if (Queue.empty()) {
+            return;
+        }
+
+        auto frame = std::move(Queue.front());
+        Queue.pop_front();
+        BusyWriters++;
+        DoneCondition.notify_all();
+        lock.unlock();
+
+        WriteFrame(frame);
+
+        lock.lock();
+        BusyWriters--;
+        Statistics.Written++;
+        LastWriteTime = Clock::now();
+        FreePixels.push_back(std::move(frame.Pixels));
+        DoneCondition.notify_all();
+    }
+}
+
+void FrameCapture::WriteFrame(const Frame& frame) const {
+    const auto fileName = GetFileName(frame);
+    const auto stride = static_cast<SizeType>(frame.Width) * BYTES_PER_PIXEL;
+
+    // OpenGL rows go bottom to top, files store them top to bottom
+    if (Options.ImageFormat == CaptureOptions::Format::PNG) {
+        const QImage image(frame.Pixels.data(), frame.Width, frame.Height,
+                           stride, QImage::Format_RGBX8888);
+        if (!image.mirrored().save(fileName, "PNG")) {
+            qWarning() << "Cannot write" << fileName;
+        }
+        return;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write" << fileName;
+        return;
+    }
+    for (auto row = frame.Height; row-- > 0;) {
+        file.write(reinterpret_cast<const char*>(frame.Pixels.data()) +
+                       row * stride,
+                   stride);
+    }
+}
+
+QString FrameCapture::GetFileName(const Frame& frame) const {
+    const auto number = QString("%1").arg(frame.Index, 6, 10, QChar('0'));
+    if (Options.ImageFormat == CaptureOptions::Format::PNG) {
+        return QDir(Options.Directory).filePath("frame-" + number + ".png");
+    }
+    // Raw files have no header, the size goes to the name
+    return QDir(Options.Directory)
+        .filePath(QString("frame-%1-%2x%3.rgba")
+                      .arg(number)
+                      .arg(frame.Width)
+                      .arg(frame.Height));
+}
@@ -0,0 +1,58 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <InstanceGrid.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+void GenerateInstanceGrid(SizeType count,
+                          LenghtType radius,
+                          InstanceVector& instances,
+                          unsigned seed) {
+    const auto PI = 4 * std::atan(1.0f);
+    const auto side = static_cast<SizeType>(std::ceil(std::sqrt(count)));
+    const auto cell = 2 * radius / std::max<SizeType>(side, 1);
+    // Largest scale that keeps an instance inside its cell
+    const auto maxScale = cell / (2 * radius);
+
+    if (count == 1) {
+        instances.assign(1, {{0, 0, 0}, {1, 1, 1}, {0, 0, 0, 1}, {0, 0, 0, 0}});
+        return;
+    }
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> unit(0, 1);
+    std::uniform_real_distribution<float> scale(0.5f * maxScale, maxScale);
+    std::uniform_real_distribution<float> depth(-radius, radius);
+
+    instances.resize(count);
+    for (SizeType i = 0; i < count; i++) {
+        auto& instance = instances[i];
+        instance.Offset[0] = -radius + cell * (i % side + 0.5f);
+        instance.Offset[1] = -radius + cell * (i / side + 0.5f);
+        instance.Offset[2] = depth(generator);
+
+        for (auto& axis : instance.Scale) {
+            axis = scale(generator);
+        }
+
+        // Uniform axis on the sphere and a uniform angle
+        const auto z = 2 * unit(generator) - 1;
+        const auto phi = 2 * PI * unit(generator);
+        const auto halfAngle = PI * unit(generator);
+        const auto r = std::sqrt(1 - z * z) * std::sin(halfAngle);
+        instance.Rotation[0] = r * std::cos(phi);
+        instance.Rotation[1] = r * std::sin(phi);
+        instance.Rotation[2] = z * std::sin(halfAngle);
+        instance.Rotation[3] = std::cos(halfAngle);
+
+        for (auto channel = 0; channel < 3; channel++) {
+            instance.Color[channel] = 0.2f + 0.8f * unit(generator);
+        }
+        instance.Color[3] = 1;
+    }
+}
@@ -0,0 +1,89 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <Ellipsoid.hpp>
+#include <LevelOfDetail.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+LevelOfDetail::LevelOfDetail(LenghtType a,
+                             LenghtType b,
+                             LenghtType c,
+                             float pixelError,
+                             float hysteresis)
+    : PixelError{pixelError}, Hysteresis{hysteresis}, SelectedScale{0} {
+    // Rings are r(h) * (a cos, b sin) with r(h) = sqrt(c^2 - h^2)
+    const auto maxAxis = std::max(a, b);
+    const auto maxHeight =
+        std::max(std::abs(Ellipsoid::MIN_HEIGHT), Ellipsoid::MAX_HEIGHT);
+    const auto minHeight =
+        Ellipsoid::MIN_HEIGHT * Ellipsoid::MAX_HEIGHT < 0
+            ? 0
+            : std::min(std::abs(Ellipsoid::MIN_HEIGHT), Ellipsoid::MAX_HEIGHT);
+    const auto c2 = c * c;
+
+    MaxRadius = maxAxis * std::sqrt(std::max(c2 - minHeight * minHeight, 0.0f));
+
+    // |r''(h)| = c^2 / (c^2 - h^2)^(3/2) grows towards the caps
+    const auto rest = c2 - maxHeight * maxHeight;
+    MaxCurvature = rest > 0 ? maxAxis * c2 / std::pow(rest, 1.5f) : 0;
+}
+
+LodLevel LevelOfDetail::Select(float pixelsPerUnit) {
+    const auto inBand = pixelsPerUnit >= SelectedScale * (1 - Hysteresis) &&
+                        pixelsPerUnit <= SelectedScale * (1 + Hysteresis);
+    if (SelectedScale == 0 || !inBand) {
+        Level = Compute(pixelsPerUnit);
+        SelectedScale = pixelsPerUnit;
+    }
+    return Level;
+}
+
+LodLevel LevelOfDetail::Compute(float pixelsPerUnit) const {
+    const auto PI = 4 * std::atan(1.0f);
+    // Error in object space units
+    const auto error = PixelError / std::max(pixelsPerUnit, 1e-6f);
+
+    // Inscribed n-gon misses the ring by R (1 - cos(PI / n))
+    auto vertexCount = MAX_VERTEX_COUNT;
+    if (error >= MaxRadius) {
+        vertexCount = MIN_VERTEX_COUNT;
+    } else {
+        const auto step = std::acos(1 - error / MaxRadius);
+        vertexCount = static_cast<SizeType>(
+            std::min<float>(std::ceil(PI / step), MAX_VERTEX_COUNT));
+    }
+
+    // A chord of length d misses the profile by |r''| d^2 / 8
+    auto surfaceCount = MAX_SURFACE_COUNT;
+    if (MaxCurvature == 0) {
+        surfaceCount = MIN_SURFACE_COUNT;
+    } else if (std::isfinite(MaxCurvature)) {
+        const auto step = std::sqrt(8 * error / MaxCurvature);
+        const auto range = Ellipsoid::MAX_HEIGHT - Ellipsoid::MIN_HEIGHT;
+        surfaceCount = static_cast<SizeType>(
+            std::min<float>(std::ceil(range / step), MAX_SURFACE_COUNT));
+    }
+
+    return {RoundUp(vertexCount, MIN_VERTEX_COUNT, MAX_VERTEX_COUNT),
+            RoundUp(surfaceCount, MIN_SURFACE_COUNT, MAX_SURFACE_COUNT)};
+}
+
+void LevelOfDetail::SetPixelError(float pixelError) {
+    PixelError = pixelError;
+    // Force a new level on the next selection
+    SelectedScale = 0;
+}
+
+SizeType LevelOfDetail::RoundUp(SizeType count, SizeType min, SizeType max) {
+    // Smallest 2^k or 3 * 2^k that is not less than count
+    SizeType power = 1;
+    while (power < count && 3 * power / 2 < count) {
+        power *= 2;
+    }
+    const auto rounded = power >= count ? power : 3 * power / 2;
+    return std::clamp(rounded, min, max);
+}
@@ -0,0 +1,41 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <MeshCache.hpp>
+
+#include <functional>
+
+MeshKey::MeshKey(const Ellipsoid& ellipsoid,
+                 SizeType vertexCount,
+                 SizeType surfaceCount,
+                 bool indexed)
+    : A{ellipsoid.GetA()},
+      B{ellipsoid.GetB()},
+      C{ellipsoid.GetC()},
+      VertexCount{vertexCount},
+      SurfaceCount{surfaceCount},
+      Indexed{indexed} {}
+
+bool MeshKey::operator==(const MeshKey& other) const {
+    return A == other.A && B == other.B && C == other.C &&
+           VertexCount == other.VertexCount &&
+           SurfaceCount == other.SurfaceCount && Indexed == other.Indexed;
+}
+
+SizeType MeshKeyHash::operator()(const MeshKey& key) const {
+    SizeType seed = 0;
+    auto combine = [&seed](SizeType value) {
+        seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+
+    std::hash<float> hashFloat;
+    combine(hashFloat(key.A));
+    combine(hashFloat(key.B));
+    combine(hashFloat(key.C));
+    combine(key.VertexCount);
+    combine(key.SurfaceCount);
+    combine(key.Indexed);
+    return seed;
+}
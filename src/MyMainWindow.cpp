@@ -7,13 +7,19 @@
 #include <MyMainWindow.hpp>
 #include <MyOpenGLWidget.hpp>
 
+#include <QCloseEvent>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QShortcut>
 #include <QSurfaceFormat>
 #include <QTabWidget>
 #include <QVBoxLayout>
 
-MyMainWindow::MyMainWindow(QWidget* parent) : QMainWindow(parent) {
+MyMainWindow::MyMainWindow(QWidget* parent)
+    : MyMainWindow(RenderOptions(), parent) {}
+
+MyMainWindow::MyMainWindow(const RenderOptions& options, QWidget* parent)
+    : QMainWindow(parent) {
     QSurfaceFormat format;
     format.setDepthBufferSize(24);
     format.setStencilBufferSize(8);
@@ -23,10 +29,20 @@ MyMainWindow::MyMainWindow(QWidget* parent) : QMainWindow(parent) {
 
     OpenGLWidget = new MyOpenGLWidget(1.1f, 1.5f, 0.2f, 20, 60);
     OpenGLWidget->setFormat(format);
+    OpenGLWidget->SetRenderOptions(options);
 
     setCentralWidget(CreateCentralWidget());
 }
 
+void MyMainWindow::StartCapture(const CaptureOptions& options) {
+    OpenGLWidget->StartCapture(options);
+}
+
+void MyMainWindow::closeEvent(QCloseEvent* event) {
+    OpenGLWidget->StopCapture();
+    QMainWindow::closeEvent(event);
+}
+
 QWidget* MyMainWindow::CreateCentralWidget() {
     const auto fixedSizePolicy =
         QSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
@@ -69,6 +85,11 @@ QWidget* MyMainWindow::CreateCentralWidget() {
     connect(controlWidget, &MyControlWidget::SurfaceCountChangedSignal,
             OpenGLWidget, &MyOpenGLWidget::SurfaceCountChangedSlot);
 
+    // F3 toggles the performance overlay
+    auto hudShortcut = new QShortcut(QKeySequence(Qt::Key_F3), widget);
+    connect(hudShortcut, &QShortcut::activated, OpenGLWidget,
+            &MyOpenGLWidget::ToggleHudSlot);
+
     mainLayout->addLayout(toolLayout);
     mainLayout->addWidget(OpenGLWidget);
     widget->setLayout(mainLayout);
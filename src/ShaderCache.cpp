@@ -0,0 +1,171 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <ShaderCache.hpp>
+
+#include <cstring>
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+ShaderCache::ShaderCache(const QString& directory)
+    : Directory{directory}, Enabled{false} {}
+
+void ShaderCache::Initialize(bool enabled) {
+    initializeOpenGLFunctions();
+    Statistics = Counters();
+    DriverId.clear();
+
+    // Core since GL 4.1 and GLES 3.0
+    const auto context = QOpenGLContext::currentContext();
+    const auto version = context->format().version();
+    const auto hasBinaries =
+        context->isOpenGLES()
+            ? version >= qMakePair(3, 0)
+            : version >= qMakePair(4, 1) ||
+                  context->hasExtension("GL_ARB_get_program_binary");
+    Enabled = enabled && hasBinaries && !Directory.isEmpty();
+    if (!Enabled) {
+        return;
+    }
+
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount <= 0 || !QDir().mkpath(Directory)) {
+        Enabled = false;
+        return;
+    }
+
+    for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        DriverId += reinterpret_cast<const char*>(glGetString(name));
+        DriverId += '\n';
+    }
+}
+
+bool ShaderCache::Link(QOpenGLShaderProgram& program,
+                       const ShaderList& shaders,
+                       const AttributeList& attributes) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(DriverId);
+
+    std::vector<QByteArray> sources;
+    for (auto&& shader : shaders) {
+        QFile file(shader.Path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Cannot read" << shader.Path;
+            return false;
+        }
+        sources.push_back(file.readAll());
+        hash.addData(QByteArray::number(static_cast<int>(shader.Type)));
+        hash.addData(sources.back());
+    }
+    // Locations are baked into the binary
+    for (auto&& attribute : attributes) {
+        if (attribute.second >= 0) {
+            program.bindAttributeLocation(attribute.first, attribute.second);
+            hash.addData(attribute.first);
+            hash.addData(QByteArray::number(attribute.second));
+        }
+    }
+
+    const auto path = QDir(Directory).filePath(
+        QString::fromLatin1(hash.result().toHex()) + ".bin");
+    if (Enabled && LoadBinary(program, path)) {
+        Statistics.Loaded++;
+        return true;
+    }
+
+    for (SizeType i = 0; i < shaders.size(); i++) {
+        program.addShaderFromSourceCode(shaders[i].Type, sources[i]);
+    }
+    if (Enabled) {
+        glProgramParameteri(program.programId(),
+                            GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    if (!program.link()) {
+        return false;
+    }
+    Statistics.Compiled++;
+
+    if (Enabled) {
+        StoreBinary(program, path);
+    }
+    return true;
+}
+
+QString ShaderCache::GetDefaultDirectory() {
+    const auto cache =
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return cache.isEmpty() ? QString() : QDir(cache).filePath("shaders");
+}
+
+bool ShaderCache::LoadBinary(QOpenGLShaderProgram& program,
+                             const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // The binary format goes first
+    const auto data = file.readAll();
+    file.close();
+    GLenum format = 0;
+    if (static_cast<SizeType>(data.size()) > sizeof(format) &&
+        program.create()) {
+        std::memcpy(&format, data.constData(), sizeof(format));
+        glProgramBinary(program.programId(), format,
+                        data.constData() + sizeof(format),
+                        data.size() - sizeof(format));
+        // Without shaders link() only checks the link status
+        if (program.link()) {
+            return true;
+        }
+    }
+
+    qDebug() << "Shader cache entry" << path << "is rejected, compiling";
+    Statistics.Rejected++;
+    QFile::remove(path);
+    return false;
+}
+
+void ShaderCache::StoreBinary(QOpenGLShaderProgram& program,
+                              const QString& path) {
+    const auto programId = program.programId();
+    GLint length = 0;
+    glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    GLenum format = 0;
+    QByteArray data(sizeof(format) + length, Qt::Uninitialized);
+    glGetProgramBinary(programId, length, &length, &format,
+                       data.data() + sizeof(format));
+    std::memcpy(data.data(), &format, sizeof(format));
+    data.resize(sizeof(format) + length);
+
+    // Other instances never see a partly written entry
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() ||
+        !file.commit()) {
+        qWarning() << "Cannot write shader cache entry" << path;
+    }
+}
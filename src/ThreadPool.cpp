@@ -0,0 +1,173 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <ThreadPool.hpp>
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(SizeType threadCount, SizeType queueCapacity)
+    : QueueCapacity{std::max<SizeType>(queueCapacity, 1)},
+      NextQueue{0},
+      PendingCount{0},
+      Stopped{false},
+      CurrentBatch{nullptr},
+      BatchContext{nullptr},
+      BatchCount{0},
+      BatchUsers{0},
+      BatchNext{0},
+      BatchDone{0} {
+    threadCount = std::max<SizeType>(threadCount, 1);
+
+    for (auto i = 0UL; i < threadCount; i++) {
+        Queues.emplace_back(std::make_unique<WorkQueue>());
+    }
+    for (auto i = 0UL; i < threadCount; i++) {
+        Workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(SleepMutex);
+        Stopped = true;
+    }
+    SleepCondition.notify_all();
+
+    for (auto&& worker : Workers) {
+        worker.join();
+    }
+}
+
+ThreadPool::SizeType ThreadPool::GetDefaultThreadCount() {
+    return std::max<SizeType>(std::thread::hardware_concurrency(), 1);
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::GetDefault() {
+    static const auto pool = std::make_shared<ThreadPool>();
+    return pool;
+}
+
+bool ThreadPool::Push(Task& task) {
+    const auto count = Queues.size();
+    const auto start = NextQueue++ % count;
+
+    for (auto i = 0UL; i < count; i++) {
+        auto& queue = *Queues[(start + i) % count];
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        if (queue.Tasks.size() < QueueCapacity) {
+            queue.Tasks.emplace_back(std::move(task));
+            PendingCount++;
+            break;
+        }
+        if (i + 1 == count) {
+            return false;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(SleepMutex);
+    }
+    SleepCondition.notify_one();
+    return true;
+}
+
+bool ThreadPool::Pop(SizeType index, Task& task) {
+    const auto count = Queues.size();
+
+    for (auto i = 0UL; i < count; i++) {
+        auto& queue = *Queues[(index + i) % count];
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        if (queue.Tasks.empty()) {
+            continue;
+        }
+
+        // Own queue is drained from the head, others are stolen from the tail
+        if (i == 0) {
+            task = std::move(queue.Tasks.front());
+            queue.Tasks.pop_front();
+        } else {
+            task = std::move(queue.Tasks.back());
+            queue.Tasks.pop_back();
+        }
+        PendingCount--;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::WorkerLoop(SizeType index) {
+    while (true) {
+        Task task;
+        if (Pop(index, task)) {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(SleepMutex);
+        if (HasBatchWork()) {
+            JoinBatch(lock);
+            continue;
+        }
+        SleepCondition.wait(lock, [this]() {
+            return Stopped || PendingCount > 0 || HasBatchWork();
+        });
+        if (Stopped && PendingCount == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::RunBatch(SizeType count,
+                          BatchFunction function,
+                          void* context) {
+    if (count == 0) {
+        return;
+    }
+
+    // One batch at a time, concurrent callers wait for their turn
+    std::lock_guard<std::mutex> batchLock(BatchMutex);
+
+    std::unique_lock<std::mutex> lock(SleepMutex);
+    CurrentBatch = function;
+    BatchContext = context;
+    BatchCount = count;
+    BatchNext = 0;
+    BatchDone = 0;
+    SleepCondition.notify_all();
+
+    JoinBatch(lock);
+
+    // Workers may still hold the function, so wait until they leave
+    BatchCondition.wait(
+        lock, [this]() { return BatchDone == BatchCount && BatchUsers == 0; });
+    CurrentBatch = nullptr;
+    BatchContext = nullptr;
+}
+
+bool ThreadPool::HasBatchWork() const {
+    return CurrentBatch != nullptr && BatchNext < BatchCount;
+}
+
+bool ThreadPool::JoinBatch(std::unique_lock<std::mutex>& lock) {
+    if (CurrentBatch == nullptr) {
+        return false;
+    }
+
+    const auto function = CurrentBatch;
+    const auto context = BatchContext;
+    const auto count = BatchCount;
+    BatchUsers++;
+    lock.unlock();
+
+    for (auto i = BatchNext++; i < count; i = BatchNext++) {
+        function(context, i);
+        BatchDone++;
+    }
+
+    lock.lock();
+    BatchUsers--;
+    BatchCondition.notify_all();
+    return true;
+}
@@ -0,0 +1,116 @@
+// Computer graphic lab 6
+// Variant 20
+// Copyright © 2017-2018 Roman Khomenko (8O-308)
+// All rights reserved
+
+#include <TransformKernel.hpp>
+
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+void PositionArray::Resize(SizeType size) {
+    X.resize(size);
+    Y.resize(size);
+    Z.resize(size);
+    W.resize(size);
+}
+
+void TransformKernel::Transform(const PositionArray& input,
+                                const Mat4x4& matrix,
+                                PositionArray& output) {
+    const auto size = input.GetSize();
+    output.Resize(size);
+
+    auto i = 0UL;
+#if defined(__AVX__)
+    const auto BLOCK = 8UL;
+    __m256 m[4][4];
+    for (auto row = 0; row < 4; row++) {
+        for (auto column = 0; column < 4; column++) {
+            m[row][column] = _mm256_set1_ps(matrix(row, column));
+        }
+    }
+
+    for (; i + BLOCK <= size; i += BLOCK) {
+        const auto x = _mm256_loadu_ps(input.X.data() + i);
+        const auto y = _mm256_loadu_ps(input.Y.data() + i);
+        const auto z = _mm256_loadu_ps(input.Z.data() + i);
+        const auto w = _mm256_loadu_ps(input.W.data() + i);
+        float* result[] = {output.X.data() + i, output.Y.data() + i,
+                           output.Z.data() + i, output.W.data() + i};
+
+        for (auto column = 0; column < 4; column++) {
+            auto value = _mm256_mul_ps(x, m[0][column]);
+            value = _mm256_add_ps(value, _mm256_mul_ps(y, m[1][column]));
+            value = _mm256_add_ps(value, _mm256_mul_ps(z, m[2][column]));
+            value = _mm256_add_ps(value, _mm256_mul_ps(w, m[3][column]));
+            _mm256_storeu_ps(result[column], value);
+        }
+    }
+#elif defined(__SSE__)
+    const auto BLOCK = 4UL;
+    __m128 m[4][4];
+    for (auto row = 0; row < 4; row++) {
+        for (auto column = 0; column < 4; column++) {
+            m[row][column] = _mm_set1_ps(matrix(row, column));
+        }
+    }
+
+    for (; i + BLOCK <= size; i += BLOCK) {
+        const auto x = _mm_loadu_ps(input.X.data() + i);
+        const auto y = _mm_loadu_ps(input.Y.data() + i);
+        const auto z = _mm_loadu_ps(input.Z.data() + i);
+        const auto w = _mm_loadu_ps(input.W.data() + i);
+        float* result[] = {output.X.data() + i, output.Y.data() + i,
+                           output.Z.data() + i, output.W.data() + i};
+
+        for (auto column = 0; column < 4; column++) {
+            auto value = _mm_mul_ps(x, m[0][column]);
+            value = _mm_add_ps(value, _mm_mul_ps(y, m[1][column]));
+            value = _mm_add_ps(value, _mm_mul_ps(z, m[2][column]));
+            value = _mm_add_ps(value, _mm_mul_ps(w, m[3][column]));
+            _mm_storeu_ps(result[column], value);
+        }
+    }
+#endif
+
+    // tail which doesn't fill a whole block
+    TransformScalar(input, matrix, i, output);
+}
+
+void TransformKernel::TransformScalar(const PositionArray& input,
+                                      const Mat4x4& matrix,
+                                      PositionArray& output) {
+    output.Resize(input.GetSize());
+    TransformScalar(input, matrix, 0, output);
+}
+
+const char* TransformKernel::GetInstructionSet() {
+#if defined(__AVX__)
+    return "AVX";
+#elif defined(__SSE__)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+void TransformKernel::TransformScalar(const PositionArray& input,
+                                      const Mat4x4& matrix,
+                                      SizeType begin,
+                                      PositionArray& output) {
+    PositionArray::FloatType* result[] = {output.X.data(), output.Y.data(),
+                                          output.Z.data(), output.W.data()};
+
+    for (auto i = begin; i < input.GetSize(); i++) {
+        const auto x = input.X[i];
+        const auto y = input.Y[i];
+        const auto z = input.Z[i];
+        const auto w = input.W[i];
+        for (auto column = 0; column < 4; column++) {
+            result[column][i] = x * matrix(0, column) + y * matrix(1, column) +
+                                z * matrix(2, column) + w * matrix(3, column);
+        }
+    }
+}
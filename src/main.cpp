@@ -3,9 +3,19 @@
 // Copyright © 2017-2018 Roman Khomenko (8O-308)
 // All rights reserved
 
+#include <FrameCapture.hpp>
 #include <MyMainWindow.hpp>
+#include <RenderOptions.hpp>
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QMap>
+
+struct ApplicationOptions {
+    RenderOptions Render;
+    CaptureOptions Capture;
+};
 
 void Init() {
     Q_INIT_RESOURCE(resources);
@@ -15,12 +25,138 @@ void Init() {
     QCoreApplication::setApplicationVersion("0.1.0");
 }
 
+ApplicationOptions ParseOptions(const QApplication& app) {
+    const QMap<QString, RenderMode> renderModes = {
+        {"cpu", RenderMode::CPU_TRANSFORM},
+        {"gpu", RenderMode::GPU_TRANSFORM},
+        {"indexed", RenderMode::INDEXED},
+        {"instanced", RenderMode::INSTANCED},
+        {"procedural", RenderMode::PROCEDURAL},
+        {"tessellated", RenderMode::TESSELLATED},
+        {"impostor", RenderMode::IMPOSTOR}};
+    const QMap<QString, CaptureOptions::Format> captureFormats = {
+        {"png", CaptureOptions::Format::PNG},
+        {"raw", CaptureOptions::Format::RAW}};
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption renderModeOption(
+        "render-mode",
+        "Rendering mode: " + QStringList(renderModes.keys()).join(", ") + ".",
+        "mode", "cpu");
+    parser.addOption(renderModeOption);
+
+    QCommandLineOption packedVerticesOption(
+        "packed-vertices",
+        "Upload 16 bytes vertices with packed normals instead of 32 bytes.");
+    parser.addOption(packedVerticesOption);
+
+    QCommandLineOption adaptiveLodOption(
+        "adaptive-lod",
+        "Choose tessellation density from the on-screen size.");
+    parser.addOption(adaptiveLodOption);
+
+    QCommandLineOption lodPixelErrorOption(
+        "lod-pixel-error",
+        "Allowed mesh error in pixels for --adaptive-lod and the "
+        "tessellated mode.",
+        "pixels", "0.5");
+    parser.addOption(lodPixelErrorOption);
+
+    QCommandLineOption instancesOption(
+        "instances", "Ellipsoids drawn in the instanced and impostor modes.",
+        "count", "1000");
+    parser.addOption(instancesOption);
+
+    QCommandLineOption syncGenerationOption(
+        "sync-generation",
+        "Generate meshes on the GUI thread instead of a background one.");
+    parser.addOption(syncGenerationOption);
+
+    QCommandLineOption meshCacheOption(
+        "mesh-cache-mb",
+        "Memory for recently generated meshes, 0 disables the cache.", "MiB",
+        "64");
+    parser.addOption(meshCacheOption);
+
+    QCommandLineOption noShaderCacheOption(
+        "no-shader-cache",
+        "Compile shaders on every start instead of loading cached program "
+        "binaries.");
+    parser.addOption(noShaderCacheOption);
+
+    QCommandLineOption captureDirOption(
+        "capture-dir", "Write every painted frame to the directory.", "dir");
+    parser.addOption(captureDirOption);
+
+    QCommandLineOption captureFormatOption(
+        "capture-format",
+        "Format of captured frames: " +
+            QStringList(captureFormats.keys()).join(", ") + ".",
+        "format", "png");
+    parser.addOption(captureFormatOption);
+    parser.process(app);
+
+    ApplicationOptions applicationOptions;
+    auto& options = applicationOptions.Render;
+    const auto mode = parser.value(renderModeOption);
+    if (renderModes.contains(mode)) {
+        options.Mode = renderModes.value(mode);
+    } else {
+        qWarning() << "Unknown render mode" << mode << ", using cpu";
+    }
+    options.PackedVertices = parser.isSet(packedVerticesOption);
+    options.AdaptiveLod = parser.isSet(adaptiveLodOption);
+    options.AsyncGeneration = !parser.isSet(syncGenerationOption);
+    options.CacheShaders = !parser.isSet(noShaderCacheOption);
+
+    bool ok = false;
+    const auto pixelError = parser.value(lodPixelErrorOption).toFloat(&ok);
+    if (ok && pixelError > 0) {
+        options.LodPixelError = pixelError;
+    } else {
+        qWarning() << "Bad LOD pixel error"
+                   << parser.value(lodPixelErrorOption);
+    }
+
+    const auto instanceCount = parser.value(instancesOption).toULong(&ok);
+    if (ok && instanceCount > 0) {
+        options.InstanceCount = instanceCount;
+    } else {
+        qWarning() << "Bad instance count" << parser.value(instancesOption);
+    }
+
+    const auto meshCacheSize = parser.value(meshCacheOption).toULong(&ok);
+    if (ok) {
+        options.MeshCacheBytes = meshCacheSize << 20;
+    } else {
+        qWarning() << "Bad mesh cache size" << parser.value(meshCacheOption);
+    }
+
+    auto& capture = applicationOptions.Capture;
+    capture.Directory = parser.value(captureDirOption);
+    const auto format = parser.value(captureFormatOption);
+    if (captureFormats.contains(format)) {
+        capture.ImageFormat = captureFormats.value(format);
+    } else {
+        qWarning() << "Unknown capture format" << format << ", using png";
+    }
+
+    return applicationOptions;
+}
+
 int main(int argc, char* argv[]) {
     QApplication a(argc, argv);
 
     Init();
 
-    MyMainWindow w;
+    const auto options = ParseOptions(a);
+    MyMainWindow w(options.Render);
+    if (!options.Capture.Directory.isEmpty()) {
+        w.StartCapture(options.Capture);
+    }
     w.show();
 
     return a.exec();